@@ -73,6 +73,14 @@ inline bool atomic_compare_exchange_16xx(T& var, T& expected, T desired, std::me
 	return rc;
 }
 
+/**
+ * @brief spin loop hint, pause instruction
+ */
+static inline void cpu_relax()
+{
+	__builtin_ia32_pause();
+}
+
 
 
 #endif // __ATOMIXX_H
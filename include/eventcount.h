@@ -20,7 +20,9 @@
 #include <chrono>
 #include <ratio>
 #include <climits>
+#include <thread>
 
+#include <errno.h>
 #include <stdint.h>
 
 #include <unistd.h>
@@ -29,6 +31,8 @@
 #include <sys/syscall.h>
 #include <time.h>
 
+#include <atomix.h>
+
 
 
 static inline long futex_call(uint32_t *futex, int futex_op, uint32_t val, uint32_t *val2, uint32_t * uaddr2, uint32_t val3)
@@ -36,14 +40,74 @@ static inline long futex_call(uint32_t *futex, int futex_op, uint32_t val, uint3
     return syscall(SYS_futex, futex, futex_op, val, val2, uaddr2, val3);
 }
 
-static inline long futex_wake(uint32_t *futex, uint32_t wakeup_count)
+/*
+ * shared = true for futexes in memory shared between processes
+ */
+static inline long futex_wake(uint32_t *futex, uint32_t wakeup_count, bool shared = false)
+{
+    return futex_call(futex, shared ? FUTEX_WAKE : FUTEX_WAKE_PRIVATE, wakeup_count, NULL, NULL, 0);
+}
+
+static inline long futex_wait(uint32_t *futex, uint32_t val, const struct timespec *timeout, bool shared = false)
+{
+    return futex_call(futex, shared ? FUTEX_WAIT : FUTEX_WAIT_PRIVATE, val, (uint32_t *) timeout, NULL, 0);
+}
+
+/*
+ * deadline is absolute CLOCK_MONOTONIC time
+ */
+static inline long futex_wait_until(uint32_t *futex, uint32_t val, const struct timespec *deadline, bool shared = false)
+{
+    return futex_call(futex, shared ? FUTEX_WAIT_BITSET : FUTEX_WAIT_BITSET_PRIVATE, val, (uint32_t *) deadline, NULL, FUTEX_BITSET_MATCH_ANY);
+}
+
+/*
+ * wait on several futexes, Linux 5.16 and later
+ * deadline is absolute CLOCK_MONOTONIC time, or NULL
+ * returns index of a woken futex, or -1 w/ errno EAGAIN if a futex didn't have its value
+ */
+static inline long futex_waitv(struct futex_waitv *waiters, unsigned int count, const struct timespec *deadline)
+{
+    return syscall(SYS_futex_waitv, waiters, count, 0, deadline, CLOCK_MONOTONIC);
+}
+
+/*
+ * futex_waitv() is supported by the kernel
+ */
+static inline bool futex_waitv_supported()
 {
-    return futex_call(futex, FUTEX_WAKE_PRIVATE, wakeup_count, NULL, NULL, 0);
+    static const bool supported = (syscall(SYS_futex_waitv, NULL, 0, 0, NULL, 0) == 0 || errno != ENOSYS);
+    return supported;
 }
 
-static inline long futex_wait(uint32_t *futex, uint32_t val, const struct timespec *timeout)
+/*
+ * brief spin before a futex wait, 12 pauses then 4 yields, same as std::atomic wait
+ * returns true as soon as pred() does
+ */
+template<typename Pred>
+static inline bool futex_spin(Pred&& pred)
 {
-    return futex_call(futex, FUTEX_WAIT_PRIVATE, val, (uint32_t *) timeout, NULL, 0);
+    for (int ndx = 0; ndx < 16; ndx++)
+    {
+        if (pred())
+            return true;
+        if (ndx < 12)
+            cpu_relax();
+        else
+            std::this_thread::yield();
+    }
+    return false;
+}
+
+/*
+ * steady_clock is CLOCK_MONOTONIC
+ */
+static inline struct timespec monotonic_timespec(std::chrono::steady_clock::time_point time)
+{
+    auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+    if (nanos < 0)
+        nanos = 0;
+    return {(time_t) (nanos / std::nano::den), (long) (nanos % std::nano::den)};
 }
 
 /*
@@ -86,6 +150,8 @@ class alignas(uint64_t) event_count
         };
     };
 
+    bool shared = false;        // process shared futex
+
 
     event_count(uint32_t futex, uint32_t waiters) : futex(futex), waiters(waiters) {}
     event_count(uint64_t val) : _val(val) {}
@@ -126,6 +192,11 @@ class alignas(uint64_t) event_count
 public:
     event_count() : futex(1), waiters(0) {};
 
+    /**
+     * @param shared eventcount is in memory shared between processes
+     */
+    explicit event_count(bool shared) : futex(1), waiters(0), shared(shared) {};
+
     ~event_count() {}
 
     /**
@@ -137,7 +208,7 @@ public:
     {
 
         xval.store(0, std::memory_order_release);
-        futex_wake(&futex, INT_MAX);
+        futex_wake(&futex, INT_MAX, shared);
     }
 
     /**
@@ -174,7 +245,7 @@ public:
             if (current != mark)    // EAGAIN
                 return;
 
-            long rc = futex_wait(&futex, current, ptimeout);
+            long rc = futex_wait(&futex, current, ptimeout, shared);
 
             if (rc == 0)
                 return;
@@ -195,6 +266,52 @@ public:
         timedwait(mark, nowait);
     }
 
+    /**
+     * @brief futex_waitv() entry for waiting on this eventcount w/ others
+     * @param mark from mark(), reset() it after the wait
+     */
+    struct futex_waitv waitv(uint32_t mark)
+    {
+        return {mark, (uintptr_t) &futex, (uint32_t) (FUTEX_32 | (shared ? 0 : FUTEX_PRIVATE_FLAG)), 0};
+    }
+
+    /**
+     * @brief eventcount futex is process shared
+     */
+    bool process_shared() { return shared; }
+
+    /**
+     * @brief eventcount wait w/ deadline
+     * @param mark from mark()
+     * @param deadline absolute steady_clock (CLOCK_MONOTONIC) time
+     * @retval true eventcount posted or closed
+     * @retval false deadline passed, the mark is still outstanding and should be reset()
+     *
+     * The deadline is absolute so interrupted and spurious wakeups don't
+     * extend the total wait.
+     */
+    bool waituntil(uint32_t mark, std::chrono::steady_clock::time_point deadline)
+    {
+        if (mark == 0)
+            return true;
+
+        struct timespec timeout = monotonic_timespec(deadline);
+
+        for (;;) {
+            uint32_t current = std::atomic_ref(futex).load(std::memory_order_acquire);
+            if (current != mark)
+                return true;
+
+            long rc = futex_wait_until(&futex, current, &timeout, shared);
+
+            if (rc == 0)
+                return true;
+
+            if (errno == ETIMEDOUT)
+                return false;
+        }
+    }
+
     /**
      * @brief reset wait count contribution from prior mark()
      */
@@ -242,10 +359,41 @@ public:
         }
         while (!xval.compare_exchange_weak(expected._val, update, std::memory_order_release));
 
-        futex_wake(&futex, INT_MAX);
+        futex_wake(&futex, INT_MAX, shared);
         return;
     }
 
+    /**
+     * @brief Increment eventcount and wake up to n waiters
+     * @param n number of waiters to wake, e.g. number of resources released
+     *
+     * The waiter count is decremented by the number woken instead of
+     * being cleared, so waiters that aren't woken are still counted and
+     * woken by later posts.  Concurrent posts each wake their n, a post
+     * doesn't return early because another post updated the eventcount.
+     * Waiters that marked but weren't waiting yet see the new eventcount
+     * value and don't wait, so counting them as woken doesn't lose wakeups.
+     */
+    void post(uint32_t n)
+    {
+        uint64_t update;
+        uint32_t woken;
+        event_count expected = xval.load(std::memory_order_acquire);
+        do {
+            if ((expected.futex) == 0)
+                return;
+
+            if (expected.waiters == 0)
+                return;
+
+            woken = expected.waiters < n ? expected.waiters : n;
+            update = ecval(expected.futex + 2, expected.waiters - woken);
+        }
+        while (!xval.compare_exchange_weak(expected._val, update, std::memory_order_release));
+
+        futex_wake(&futex, woken, shared);
+    }
+
 
 
 
@@ -0,0 +1,147 @@
+/*
+   Copyright 2025 Joseph W. Seigh
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <system_error>
+
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+
+/**
+ * @brief armed eventfd, readable after a state change a waiter asked for
+ *
+ * A waiter arms the signal, which also resets the eventfd, and then rechecks
+ * its condition before it polls the fd.  The signaler updates the state,
+ * fences, and only writes the eventfd if the signal was armed, disarming it,
+ * so there's one write per transition a waiter saw and none otherwise.
+ * Either the signaler sees the arm or the waiter's recheck sees the update,
+ * same as an eventcount.  The fd can be added to an epoll set or io_uring
+ * poll, it's non-blocking and close on exec.
+ *
+ * A latched signal, e.g. after the queue is closed, stays readable, arming
+ * it writes the eventfd again right after resetting it.
+ *
+ * The eventfd is opened by open(), so an unused signal doesn't take an fd.
+ */
+class eventfd_signal
+{
+    int fd = -1;
+    std::atomic<bool> armed = false;
+    std::atomic<bool> latched = false;
+
+public:
+
+    eventfd_signal() {}
+
+    ~eventfd_signal()
+    {
+        if (fd >= 0)
+            ::close(fd);
+    }
+
+    eventfd_signal(const eventfd_signal&) = delete;
+    eventfd_signal& operator =(const eventfd_signal&) = delete;
+
+    /**
+     * @brief open the eventfd
+     * @throws system_error if the eventfd can't be created
+     */
+    void open()
+    {
+        fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (fd < 0)
+            throw std::system_error(errno, std::generic_category(), "eventfd");
+    }
+
+    /**
+     * @brief the eventfd, -1 if not open
+     */
+    int get() const { return fd; }
+
+    /**
+     * @brief reset the eventfd and arm, recheck the condition afterwards
+     */
+    void arm()
+    {
+        uint64_t count;
+        while (::read(fd, &count, sizeof(count)) < 0 && errno == EINTR)
+            ;
+        armed.store(true, std::memory_order_seq_cst);
+        if (latched.load(std::memory_order_seq_cst))
+            notify();
+    }
+
+    /**
+     * @brief write the eventfd if armed, after a state change
+     */
+    inline void signal()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (armed.load(std::memory_order_relaxed) && armed.exchange(false, std::memory_order_relaxed))
+            notify();
+    }
+
+    /**
+     * @brief write the eventfd unconditionally
+     */
+    void notify()
+    {
+        uint64_t one = 1;
+        while (::write(fd, &one, sizeof(one)) < 0 && errno == EINTR)
+            ;
+    }
+
+    /**
+     * @brief write the eventfd and keep it readable, e.g. on close
+     *
+     * Either the write is reset by an arm() that then sees latched and
+     * writes it again, or the write comes after the reset.
+     */
+    void latch()
+    {
+        latched.store(true, std::memory_order_seq_cst);
+        notify();
+    }
+
+    /**
+     * @brief poll the eventfd
+     * @param deadline absolute steady_clock (CLOCK_MONOTONIC) time, or nullptr to wait forever
+     * @return false if deadline passed
+     */
+    bool wait(const std::chrono::steady_clock::time_point* deadline)
+    {
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        if (deadline == nullptr)
+            return ::poll(&pfd, 1, -1) != 0;
+
+        auto remaining = *deadline - std::chrono::steady_clock::now();
+        if (remaining <= std::chrono::steady_clock::duration::zero())
+            return false;
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(remaining).count();
+        struct timespec timeout = { (time_t) (ns / 1000000000), (long) (ns % 1000000000) };
+        return ::ppoll(&pfd, 1, &timeout, nullptr) != 0;
+    }
+};
+
+/*==*/
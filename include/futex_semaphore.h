@@ -0,0 +1,146 @@
+/*
+   Copyright 2025 Joseph W. Seigh
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+
+#include <errno.h>
+#include <stdint.h>
+
+#include <eventcount.h>
+
+
+/**
+ * @brief counting semaphore w/ a waiter count
+ *
+ * Waiters register before they load the count and release loads the waiter
+ * count after it updates the count, both seq_cst, so release only makes the
+ * futex wake syscall when a thread is or may be about to wait.  Uncontended
+ * acquire and release are a single atomic op each on the count.  Acquire
+ * spins briefly before registering and waiting.
+ */
+class futex_semaphore
+{
+    alignas(uint64_t) std::atomic<uint32_t> count;
+    std::atomic<uint32_t> waiters = 0;
+
+    /**
+     * @brief take one if count non-zero
+     */
+    bool take()
+    {
+        uint32_t current = count.load(std::memory_order_relaxed);
+        while (current != 0)
+            if (count.compare_exchange_weak(current, current - 1, std::memory_order_acquire, std::memory_order_relaxed))
+                return true;
+        return false;
+    }
+
+    /**
+     * @param deadline absolute CLOCK_MONOTONIC time, or nullptr to wait forever
+     * @return false if deadline passed
+     */
+    bool acquire_wait(const struct timespec* deadline)
+    {
+        if (futex_spin([this] { return take(); }))
+            return true;
+
+        waiters.fetch_add(1, std::memory_order_seq_cst);
+        bool acquired;
+        for (;;)
+        {
+            uint32_t current = count.load(std::memory_order_seq_cst);
+            if (current != 0)
+            {
+                if (count.compare_exchange_weak(current, current - 1, std::memory_order_acquire, std::memory_order_relaxed))
+                {
+                    acquired = true;
+                    break;
+                }
+                continue;
+            }
+
+            long rc = deadline == nullptr ? futex_wait((uint32_t*) &count, 0, nullptr) : futex_wait_until((uint32_t*) &count, 0, deadline);
+            if (rc != 0 && errno == ETIMEDOUT)
+            {
+                acquired = take();
+                break;
+            }
+        }
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+        return acquired;
+    }
+
+public:
+
+    explicit futex_semaphore(uint32_t count) : count(count) {}
+
+    futex_semaphore(const futex_semaphore&) = delete;
+    futex_semaphore& operator =(const futex_semaphore&) = delete;
+
+    bool try_acquire() { return take(); }
+
+    /**
+     * @brief acquire up to max w/o blocking
+     * @return number acquired
+     */
+    uint32_t try_acquire_many(uint32_t max)
+    {
+        uint32_t current = count.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            uint32_t n = current < max ? current : max;
+            if (n == 0)
+                return 0;
+            if (count.compare_exchange_weak(current, current - n, std::memory_order_acquire, std::memory_order_relaxed))
+                return n;
+        }
+    }
+
+    void acquire()
+    {
+        if (!take())
+            acquire_wait(nullptr);
+    }
+
+    /**
+     * @brief acquire, blocks until deadline
+     * @param deadline absolute steady_clock (CLOCK_MONOTONIC) time
+     * @return false if deadline passed
+     */
+    bool try_acquire_until(std::chrono::steady_clock::time_point deadline)
+    {
+        if (take())
+            return true;
+        struct timespec timeout = monotonic_timespec(deadline);
+        return acquire_wait(&timeout);
+    }
+
+    /**
+     * @brief release n, wake up to n waiters if there are any
+     */
+    void release(uint32_t n = 1)
+    {
+        count.fetch_add(n, std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_seq_cst) != 0)
+            futex_wake((uint32_t*) &count, n < INT_MAX ? n : INT_MAX);
+    }
+};
+
+/*==*/
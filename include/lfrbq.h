@@ -17,6 +17,7 @@
 #pragma once
 
 #include <type_traits>
+#include <algorithm>
 #include <atomic>
 #include <stdexcept>
 #include <cstddef>
@@ -27,41 +28,24 @@
 #include <stdio.h>
 
 #include <atomix.h>
-
-
-/**
- * per thread statistics
- * 
- * waits are counts of yield(), eventcount.wait(), or cvar.wait()
- */
-struct lfrbq_stats_t {
-    uint32_t queue_full_count = 0;      // queue full count
-    uint32_t queue_empty_count = 0;     // queue empty count
-
-    uint32_t producer_waits = 0;        // rbq enqueue waits for non-full queue
-    uint32_t consumer_waits = 0;        // rbq dequeue  waits for non-empty queue
-
-    uint32_t producer_retries = 0;      // producer atomic op retries
-    uint32_t consumer_retries = 0;      // consumer atomic op retries
-
-    uint32_t producer_wraps = 0;        // producer detected wraps
-    uint32_t consumer_wraps = 0;        // consumer detected wraps
-
-    uint32_t invalid_head_sync = 0;     // head observed by producer w/ staler value than it should have been
-};
-
-inline thread_local lfrbq_stats_t tls_lfrbq_stats;
+#include <lfrbq_alloc.h>
+#include <lfrbq_stats.h>
 
 
 using seq_t = uint64_t;
-using stat_t = uint32_t;
+using stat_t = uint64_t;
 
 constexpr seq_t Q_CLOSED = 1;   // sequence bit indicating queue has been closed
 
+constexpr seq_t Q_FULL = 1;     // mpmc_faa node sequence bit, node has a value
+constexpr seq_t Q_UNSAFE = 2;   // mpmc_faa node sequence bit, node value skipped by a dequeue
+constexpr seq_t Q_TAIL_CLOSED = (seq_t) 1 << 63;    // mpmc_faa tail bit indicating queue has been closed
+constexpr unsigned int Q_FAA_SKIPS = 8;     // mpmc_faa skipped tail positions before an enqueue stops claiming w/ fetch_add
+
 /**
  * @brief lfrb queue type
  *
- * enum value = (sp_mode * 2) + sc_mode
+ * enum value = (faa_mode * 4) + (sp_mode * 2) + sc_mode
  */
 enum lfrbq_type
 {
@@ -73,6 +57,56 @@ enum lfrbq_type
     spmc = 2,   // single producer, multi-consumer
     /** single producer, single consumer */
     spsc = 3,   // single producer, single consumer
+
+    /** multi-producer, multi-consumer, head and tail claimed w/ fetch_add */
+    mpmc_faa = 4,   // multi-producer, multi-consumer, fetch_add
+
+    /** queue type set at runtime by ctor parameters */
+    runtime_qtype = -1,
+};
+
+
+/**
+ * @brief ring buffer node layout
+ */
+enum lfrbq_layout
+{
+    linear_layout = 0,      // consecutive sequence numbers in consecutive nodes
+    spread_layout = 1,      // consecutive sequence numbers in different cache lines
+};
+
+
+/**
+ * @brief producer/consumer mode fixed at compile time
+ */
+template<lfrbq_type qtype>
+struct lfrbq_mode
+{
+    static constexpr bool sp_mode = (qtype & 2) != 0;
+    static constexpr bool sc_mode = (qtype & 1) != 0;
+    static constexpr bool faa_mode = (qtype & 4) != 0;
+
+    /**
+     * @throws invalid_argument if the modes don't match qtype
+     */
+    lfrbq_mode(bool sp, bool sc, bool faa)
+    {
+        if (sp != sp_mode || sc != sc_mode || faa != faa_mode)
+            throw std::invalid_argument("queue mode doesn't match queue type");
+    }
+};
+
+/**
+ * @brief producer/consumer mode set at runtime
+ */
+template<>
+struct lfrbq_mode<runtime_qtype>
+{
+    const bool sp_mode;                     // single producer mode -- enqueue not thread-safe
+    const bool sc_mode;                     // single consumer mode -- dequeue not thread-safe
+    const bool faa_mode;                    // fetch_add mpmc mode
+
+    lfrbq_mode(bool sp_mode, bool sc_mode, bool faa_mode) : sp_mode(sp_mode), sc_mode(sc_mode), faa_mode(faa_mode) {}
 };
 
 
@@ -82,15 +116,22 @@ enum lfrbq_status
     fail,       // queue operation failed, unknown error
     empty,      // dequeue failed, queue empty
     full,       // enqueue failed, queue full
-    closed      // queue operation failed, queue is closed
+    closed,     // queue operation failed, queue is closed
+    timedout    // blocking queue operation failed, deadline passed
 };
 
 
+/**
+ * @brief ring buffer node, 64 bit sequence and 64 bit value
+ * updated w/ a 128 bit compare and swap.
+ */
 struct alignas(16) lfrbq_node
 {
     std::atomic<seq_t> seq;
     std::atomic<uintptr_t> value;
 
+    static constexpr uint32_t max_capacity = 0x80000000;
+
     lfrbq_node(seq_t seq, uintptr_t value) : seq(seq), value(value) {}
     lfrbq_node() : seq(0), value(0) {}
 
@@ -100,28 +141,122 @@ struct alignas(16) lfrbq_node
         seq.store(node.seq.load(std::memory_order_acquire), std::memory_order_relaxed);
         value.store(node.value.load(std::memory_order_relaxed), std::memory_order_relaxed);
     }
+
+    /**
+     * @brief node sequence
+     * @param ref head or tail sequence the node sequence is compared to, not used
+     * @param order memory order
+     */
+    inline seq_t load_seq(seq_t ref, std::memory_order order) { return seq.load(order); }
+
+    inline uintptr_t load_value(std::memory_order order) { return value.load(order); }
+
+    /**
+     * @brief set node sequence and value, single producer
+     */
+    inline void store(seq_t new_seq, uintptr_t new_value)
+    {
+        value.store(new_value, std::memory_order_relaxed);
+        seq.store(new_seq, std::memory_order_release);
+    }
+
+    /**
+     * @brief update node sequence and value if unchanged
+     */
+    inline bool compare_exchange(seq_t old_seq, uintptr_t old_value, seq_t new_seq, uintptr_t new_value)
+    {
+        lfrbq_node update(new_seq, new_value);
+        lfrbq_node expected(old_seq, old_value);
+        return atomic_compare_exchange_16xx(*this, expected, update, std::memory_order_release);
+    }
+
+    inline void set_closed() { seq.fetch_or(Q_CLOSED, std::memory_order_release); }
 };
 
 
+/**
+ * @brief compact ring buffer node, 32 bit sequence and 32 bit value
+ * packed in one 64 bit word updated w/ a 64 bit compare and swap.
+ *
+ * Only the low 32 bits of the node sequence are kept.  They are extended
+ * back to 64 bits relative to the head or tail sequence they are compared
+ * to, which is exact as long as the two are w/in 2^31 of each other.  The
+ * capacity is limited to 2^30 so node sequences one lap ahead or behind
+ * are always w/in range.  Values are truncated to 32 bits.
+ */
+struct alignas(8) lfrbq_compact_node
+{
+    std::atomic<uint64_t> word;
+
+    static constexpr uint32_t max_capacity = 0x40000000;
+
+    static constexpr uint64_t pack(seq_t seq, uintptr_t value) { return ((uint64_t) (uint32_t) value << 32) | (uint32_t) seq; }
+
+    static inline seq_t widen(uint32_t node_seq, seq_t ref) { return ref + (int32_t) (node_seq - (uint32_t) ref); }
+
+    lfrbq_compact_node() : word(0) {}
+
+    inline seq_t load_seq(seq_t ref, std::memory_order order) { return widen((uint32_t) word.load(order), ref); }
+
+    inline uintptr_t load_value(std::memory_order order) { return word.load(order) >> 32; }
+
+    inline void store(seq_t new_seq, uintptr_t new_value) { word.store(pack(new_seq, new_value), std::memory_order_release); }
+
+    inline bool compare_exchange(seq_t old_seq, uintptr_t old_value, seq_t new_seq, uintptr_t new_value)
+    {
+        uint64_t expected = pack(old_seq, old_value);
+        return word.compare_exchange_strong(expected, pack(new_seq, new_value), std::memory_order_release, std::memory_order_relaxed);
+    }
+
+    inline void set_closed() { word.fetch_or(Q_CLOSED, std::memory_order_release); }
+};
+
 
-class alignas(64) lfrbq
+/**
+ * @brief lock-free ring buffer or bounded queue
+ * @tparam qtype queue type, one of mpmc, mpsc, spmc, spsc, or mpmc_faa,
+ *               or runtime_qtype (the default) to set it w/ the ctor
+ *
+ * @tparam node_t ring buffer node type, lfrbq_node (the default) or
+ *               lfrbq_compact_node for 32 bit values
+ *
+ * A fixed queue type lets the enqueue/dequeue mode tests be
+ * resolved at compile time.
+ */
+template<lfrbq_type qtype = runtime_qtype, typename node_t = lfrbq_node>
+class alignas(64) lfrbq : protected lfrbq_mode<qtype>
 {
 protected:
 
+    using lfrbq_mode<qtype>::sp_mode;       // single producer mode -- enqueue not thread-safe
+    using lfrbq_mode<qtype>::sc_mode;       // single consumer mode -- dequeue not thread-safe
+    using lfrbq_mode<qtype>::faa_mode;      // fetch_add mpmc mode
+
+    static constexpr bool faa_only = qtype != runtime_qtype && (qtype & 4) != 0;   // node CAS paths not used
+
     const uint32_t capacity;                // capacity -- power of 2    xxxxx10...0
     const seq_t mask;                       // capacity - 1              xxxxx01...1
     const seq_t seq_mask;                   // sequence w/o index bits   1111110...0
-    const bool sp_mode;                     // single producer mode -- enqueue not thread-safe
-    const bool sc_mode;                     // single consumer mode -- dequeue not thread-safe
 
     std::atomic<bool> qclosed = false;
 
 
-    lfrbq_node* rbuffer;                     // the ring buffer
+    ptrdiff_t rbuffer_offset;                // the ring buffer, address relative to this so it's valid in a shared mapping
+    lfrbq_buffer rbuffer_mem;                // ring buffer allocation, see lfrbq_alloc_options, empty if caller owned
+
+    [[no_unique_address]] lfrbq_stats stats_counter;    // see lfrbq_stats.h
+
+    const unsigned int layout_shift;         // rnode() index rotate shifts, see lfrbq_layout
+    const unsigned int layout_rshift;
 
 
     alignas(64) std::atomic<seq_t> head;    // next available full buffer if head == rbuffer[seq2ndx(head)]
+    seq_t tail_cache;                       // spsc mode consumer copy of tail
+
     alignas(64) std::atomic<seq_t> tail;    // next available empty buffer if tail == rbuffer[seq2ndx(tail)]
+    seq_t head_cache;                       // sp mode producer copy of head
+
+    static constexpr unsigned int nodes_per_line = 64 / sizeof(node_t);
 
     /**
      * Convert sequence to index into rbuffer array
@@ -130,6 +265,27 @@ protected:
      */
     unsigned int seq2ndx(seq_t seq) { return seq & mask; }
 
+    /**
+     * @brief ring buffer node for index
+     * @param ndx index from seq2ndx()
+     * @return node
+     *
+     * For spread_layout the index bits are rotated left so the low bits,
+     * which select the node w/in a cache line, select the cache line instead.
+     */
+    inline node_t& rnode(unsigned int ndx) { return rbuffer()[((ndx << layout_shift) | (ndx >> layout_rshift)) & mask]; }
+
+    /**
+     * @brief the ring buffer
+     */
+    inline node_t* rbuffer() { return (node_t*) ((char*) this + rbuffer_offset); }
+
+    /**
+     * @brief add to this thread's statistics counter for the queue
+     * @param counter lfrbq_stats_t member
+     */
+    inline void count_stat(uint64_t lfrbq_stats_t::* counter) { stats_counter.count(counter); }
+
     /**
      * @brief Convert head or tail sequence to node sequence
      */
@@ -143,22 +299,43 @@ protected:
      */
     int64_t xcmp(seq_t a, seq_t b) { return (a - b); }
 
+    /**
+     * @brief prefetch the next cache line of nodes when seq is
+     * at the start of a cache line, linear_layout only
+     * @tparam rw 1 to prefetch for write, 0 for read
+     */
+    template<int rw>
+    inline void prefetch_next(seq_t seq)
+    {
+        if (layout_shift == 0 && (seq & (nodes_per_line - 1)) == 0)
+            __builtin_prefetch(&rnode(seq2ndx(seq + nodes_per_line)), rw);
+    }
 
-public:
+
+    struct init_t {};
 
     /**
-     * @brief create lock-free ring buffer or bounded queue
-     * @param capacity of queue, must be power of 2 and >= 2
-     * @param sp_mode single producer if true
-     * @param sc_mode single consumer if true
-     * @throws invalid_argument if size not power of 2 or size is less than 2
+     * @brief rnode() index rotate left shift for layout
+     */
+    static unsigned int layout_bits(uint32_t capacity, lfrbq_layout layout)
+    {
+        if (layout == spread_layout && capacity >= 2 * nodes_per_line)
+            return __builtin_ctz(nodes_per_line);
+        else
+            return 0;
+    }
+
+    /**
+     * @brief common ctor for public ctors
+     * @param nodes caller owned ring buffer or nullptr to allocate one per alloc
      */
-    lfrbq(uint32_t capacity, bool sp_mode, bool sc_mode) :
+    lfrbq(init_t, uint32_t capacity, bool sp_mode, bool sc_mode, bool faa_mode, lfrbq_layout layout, const lfrbq_alloc_options& alloc, node_t* nodes = nullptr) :
+        lfrbq_mode<qtype>(sp_mode, sc_mode, faa_mode),
         capacity(capacity),
         mask(capacity - 1),
         seq_mask(~mask),
-        sp_mode(sp_mode),
-        sc_mode(sc_mode)
+        layout_shift(layout_bits(capacity, layout)),
+        layout_rshift(__builtin_ctz(capacity) - layout_shift)
     {
         if ((capacity & (capacity - 1)) != 0)
         {
@@ -170,36 +347,105 @@ public:
             throw std::invalid_argument("size is less than 2");
         }
 
+        if (capacity > node_t::max_capacity)
+        {
+            throw std::invalid_argument("size too large for node type");
+        }
 
-        /*--*/
+        if (faa_mode && capacity < 4)
+        {
+            throw std::invalid_argument("size is less than 4 for mpmc_faa");   // Q_FULL and Q_UNSAFE bits
+        }
 
-        this->head.store(capacity, std::memory_order_relaxed);
-        this->tail.store(0, std::memory_order_relaxed);
+
+        /*--*/
 
         /*
          * allocate and initialize ring buffer
         */
 
-        size_t sz = (capacity * sizeof(lfrbq_node));
-        this->rbuffer = (lfrbq_node*) aligned_alloc(16, sz);
-        // memset(this->rbuffer, 0, sz);
+        if (nodes == nullptr)
+        {
+            size_t sz = (capacity * sizeof(node_t));
+            this->rbuffer_mem = lfrbq_alloc_buffer(sz, alloc);
+            nodes = (node_t*) rbuffer_mem.addr;
+        }
+        this->rbuffer_offset = (char*) nodes - (char*) this;
+
+        // zeroed memory is already initialized nodes, leave the pages untouched
+        // so they're placed by first touch unless prefaulted
+        reset(!rbuffer_mem.zeroed);
+
+    }   // CTOR
+
+    /**
+     * @brief reset to an empty open queue, not thread-safe
+     * @param init_nodes initialize ring buffer nodes, false only if
+     * the nodes are known to be zero
+     */
+    void reset(bool init_nodes = true)
+    {
+        this->qclosed.store(false, std::memory_order_relaxed);
+
+        this->head.store(capacity, std::memory_order_relaxed);
+        this->tail.store(0, std::memory_order_relaxed);
+        this->head_cache = capacity;
+        this->tail_cache = 0;
+
+        if (!init_nodes)
+            return;
 
         for (unsigned int ndx = 0; ndx < capacity; ndx++)
         {
-            rbuffer[ndx].value.store(0, std::memory_order_relaxed);
-            // this->rbuffer[ndx].seq.store(ndx, std::memory_order_relaxed);
-            this->rbuffer[ndx].seq.store(0, std::memory_order_relaxed);
+            new (&rbuffer()[ndx]) node_t();
         }
+    }
 
-    }   // CTOR
+    /**
+     * @brief create queue of type qtype on a caller owned ring buffer,
+     * e.g. in the same shared memory segment as the queue
+     * @param nodes ring buffer of capacity nodes, not freed by the queue
+     */
+    lfrbq(uint32_t capacity, lfrbq_layout layout, node_t* nodes) requires (qtype != runtime_qtype) :
+        lfrbq(init_t{}, capacity, lfrbq_mode<qtype>::sp_mode, lfrbq_mode<qtype>::sc_mode, lfrbq_mode<qtype>::faa_mode, layout, {}, nodes) {}
+
+public:
+
+    /**
+     * @brief create lock-free ring buffer or bounded queue
+     * @param capacity of queue, must be power of 2 and >= 2
+     * @param sp_mode single producer if true
+     * @param sc_mode single consumer if true
+     * @param layout ring buffer node layout
+     * @param alloc ring buffer allocation options
+     * @throws invalid_argument if size not power of 2 or size is less than 2
+     * @throws bad_alloc if ring buffer can't be allocated as requested by alloc
+     */
+    lfrbq(uint32_t capacity, bool sp_mode, bool sc_mode, lfrbq_layout layout = linear_layout, const lfrbq_alloc_options& alloc = {}) requires (qtype == runtime_qtype) :
+        lfrbq(init_t{}, capacity, sp_mode, sc_mode, false, layout, alloc) {}
 
     /**
      * @brief create lock-free ring buffer or bounded queue
      * @param size or capacity of queue, must be power of 2
-     * @param qtype queue type, one of mpmc, mpsc, spmc, or spsc
+     * @param type queue type, one of mpmc, mpsc, spmc, spsc, or mpmc_faa
+     * @param layout ring buffer node layout
+     * @param alloc ring buffer allocation options
      * @throws invalid_argument if size not power of 2
+     * @throws bad_alloc if ring buffer can't be allocated as requested by alloc
+     */
+    lfrbq(uint32_t size, lfrbq_type type, lfrbq_layout layout = linear_layout, const lfrbq_alloc_options& alloc = {}) requires (qtype == runtime_qtype) :
+        lfrbq(init_t{}, size, type & 2, type & 1, type & 4, layout, alloc) {}
+
+    /**
+     * @brief create lock-free ring buffer or bounded queue of type qtype
+     * @param capacity of queue, must be power of 2 and >= 2
+     * @param layout ring buffer node layout
+     * @param alloc ring buffer allocation options
+     * @throws invalid_argument if size not power of 2 or size is less than 2
+     * @throws bad_alloc if ring buffer can't be allocated as requested by alloc
      */
-    lfrbq(uint32_t size, lfrbq_type qtype) : lfrbq(size, qtype & 2, qtype & 1) {}
+    explicit lfrbq(uint32_t capacity, lfrbq_layout layout = linear_layout, const lfrbq_alloc_options& alloc = {}) requires (qtype != runtime_qtype) :
+        lfrbq(init_t{}, capacity, lfrbq_mode<qtype>::sp_mode, lfrbq_mode<qtype>::sc_mode, lfrbq_mode<qtype>::faa_mode, layout, alloc) {}
 
     ~lfrbq()
     {
@@ -207,7 +453,7 @@ public:
         {
             // invoke dtors if required
         }
-        free(rbuffer);
+        lfrbq_free_buffer(rbuffer_mem);
     }
 
 private:
@@ -217,9 +463,9 @@ private:
         seq_t tail_copy = tail.load(std::memory_order_acquire);   // always current
 
         unsigned int ndx = seq2ndx(tail_copy);
-        lfrbq_node *node = &rbuffer[ndx];
+        node_t *node = &rnode(ndx);
 
-        seq_t node_seq = node->seq.load(std::memory_order_relaxed);
+        seq_t node_seq = node->load_seq(tail_copy, std::memory_order_relaxed);
 
         if (node_seq & Q_CLOSED)
             return lfrbq_status::closed;
@@ -228,15 +474,18 @@ private:
             return lfrbq_status::full;   // full
         }
 
-        seq_t head_copy = head.load(std::memory_order_relaxed);
-        if ((node_seq + ndx) == head_copy) {
-            return lfrbq_status::full;   // full
+        if (tail_copy == head_cache) {                                  // full per cached head, reload head
+            head_cache = head.load(std::memory_order_acquire);
+            if (tail_copy == head_cache) {
+                return lfrbq_status::full;   // full
+            }
         }
 
-        node->value.store(value, std::memory_order_relaxed);
-        node->seq.store(node_seq + (seq_t) capacity, std::memory_order_release);
+        node->store(node_seq + (seq_t) capacity, value);
         tail.store(tail_copy + 1, std::memory_order_release);
 
+        prefetch_next<1>(tail_copy + 1);
+
         return lfrbq_status::success;
     }
 
@@ -295,7 +544,7 @@ private:
             seq_t tail_copy = tail.load(std::memory_order_relaxed);
 
             unsigned int ndx = seq2ndx(tail_copy);
-            seq_t node_seq = rbuffer[ndx].seq.load(std::memory_order_relaxed);
+            seq_t node_seq = rnode(ndx).load_seq(tail_copy, std::memory_order_relaxed);
             if (node_seq & Q_CLOSED)
                 return lfrbq_status::closed;
 
@@ -304,7 +553,7 @@ private:
                 uint64_t tail_latency = node_seq - seq2node(tail_copy);
                 if (tail_latency > capacity)
                 {
-                    tls_lfrbq_stats.producer_wraps++;
+                    count_stat(&lfrbq_stats_t::producer_wraps);
                     // fprintf(stderr, "wrapped tail seq=%llu tail_copy=%llu\n", seq, tail_copy);   // ???
                     tail_copy = (node_seq - capacity) + ndx;
                 }
@@ -314,7 +563,7 @@ private:
                 }
 
                 ndx = seq2ndx(tail_copy);
-                node_seq = rbuffer[ndx].seq.load(std::memory_order_relaxed);
+                node_seq = rnode(ndx).load_seq(tail_copy, std::memory_order_relaxed);
                 if (node_seq & Q_CLOSED)
                     return lfrbq_status::closed;
             }
@@ -340,14 +589,14 @@ private:
                     return lfrbq_status::full;
 
                 if (cc > 0) {                                   // head too stale, observed as less than tail (should never happen and this logic will get removed at some point)
-                    tls_lfrbq_stats.invalid_head_sync++;
+                    count_stat(&lfrbq_stats_t::invalid_head_sync);
                     abort();
                     return lfrbq_status::full;                  // handle as full and hope memory syncs up after polling retry
                 }
             }
 
             // seq == tail
-            uintptr_t old_value = rbuffer[ndx].value.load(std::memory_order_relaxed);
+            uintptr_t old_value = rnode(ndx).load_value(std::memory_order_relaxed);
 
 
             auto x = (this->*updater)(ndx, node_seq, old_value, new_value);
@@ -359,29 +608,23 @@ private:
 
     bool update_node_value(unsigned int ndx, seq_t sequence, uintptr_t old_value, uintptr_t new_value)
     {
-        lfrbq_node update(sequence + capacity, new_value);
-        lfrbq_node expected(sequence, old_value);
-
         seq_t tail_copy = sequence + ndx;
 
-        if (atomic_compare_exchange_16xx(rbuffer[ndx], expected, update, std::memory_order_release))
+        if (rnode(ndx).compare_exchange(sequence, old_value, sequence + capacity, new_value))
         {
             try_update_tail(tail_copy + 1);
             return true;
         }
         else
         {
-            tls_lfrbq_stats.producer_retries++;
+            count_stat(&lfrbq_stats_t::producer_retries);
             return false;
         }
     }
 
     bool set_closed(unsigned int ndx, seq_t sequence, uintptr_t old_value, uintptr_t new_value)
     {
-        lfrbq_node update(sequence | Q_CLOSED, old_value);
-        lfrbq_node expected(sequence, old_value);
-
-        return atomic_compare_exchange_16xx(rbuffer[ndx], expected, update, std::memory_order_release);
+        return rnode(ndx).compare_exchange(sequence, old_value, sequence | Q_CLOSED, old_value);
     }
 
     lfrbq_status enqueue_mp(uintptr_t value)
@@ -390,21 +633,43 @@ private:
     }
 
 
+    /**
+     * @brief dequeue, single consumer
+     *
+     * @note
+     * In spsc mode the node sequence isn't checked.  The tail is only
+     * updated after the node so the node is full if the head is less than
+     * a (cached) copy of the tail.
+     */
     bool dequeue_sc(uintptr_t *value)
     {
         seq_t head_copy = head.load(std::memory_order_acquire);
 
         unsigned int ndx = seq2ndx(head_copy);
-        lfrbq_node *node = &rbuffer[ndx];
+        node_t *node = &rnode(ndx);
 
-        seq_t node_seq = node->seq.load(std::memory_order_relaxed);
+        if (sp_mode)
+        {
+            if (xcmp(head_copy, tail_cache + capacity) >= 0) {         // empty per cached tail, reload tail
+                tail_cache = tail.load(std::memory_order_acquire);
+                if (xcmp(head_copy, tail_cache + capacity) >= 0) {
+                    return false;   // empty
+                }
+            }
+        }
+        else
+        {
+            seq_t node_seq = node->load_seq(head_copy, std::memory_order_relaxed) & ~Q_CLOSED;
 
-        if (node_seq != seq2node(head_copy)) {
-            return false;   // empty
+            if (node_seq != seq2node(head_copy)) {
+                return false;   // empty
+            }
         }
 
-        *value = node->value.load(std::memory_order_acquire);
-        head.store(head_copy + 1, std::memory_order_relaxed);
+        *value = node->load_value(std::memory_order_acquire);
+        head.store(head_copy + 1, std::memory_order_release);
+
+        prefetch_next<0>(head_copy + 1);
 
         return true;
     }
@@ -413,34 +678,569 @@ private:
     {
         uintptr_t _value;
         seq_t head_copy = head.load(std::memory_order_relaxed);
-        outer:
-        do {
+        for (;;)
+        {
             unsigned int ndx = seq2ndx(head_copy);
 
-            seq_t node_seq = rbuffer[ndx].seq.load(std::memory_order_acquire);
+            seq_t node_seq = rnode(ndx).load_seq(head_copy, std::memory_order_acquire) & ~Q_CLOSED;
             int64_t cc = xcmp(node_seq, seq2node(head_copy));
             if (cc < 0) {
                 return false;   // seq < head  --  empty
             }
             else if (cc > 0) {  // seq > head  --  wrapped, reload head and retry
-                tls_lfrbq_stats.consumer_wraps++;
+                count_stat(&lfrbq_stats_t::consumer_wraps);
                 head_copy = head.load(std::memory_order_relaxed);   // reload head
-                // continue;
-                goto outer;
+                continue;
             }
             else // seq == head
                 ;
 
-            _value = rbuffer[ndx].value.load(std::memory_order_acquire);
-            tls_lfrbq_stats.consumer_retries++;
+            _value = rnode(ndx).load_value(std::memory_order_acquire);
+            if (head.compare_exchange_weak(head_copy, head_copy + 1, std::memory_order_relaxed))
+                break;
+            count_stat(&lfrbq_stats_t::consumer_retries);
         }
-        while (!head.compare_exchange_weak(head_copy, head_copy + 1, std::memory_order_relaxed));
-        tls_lfrbq_stats.consumer_retries--;
 
         *value = _value;
         return true;
     }
 
+    /**
+     * @brief enqueue run of values, single producer
+     * @param values to be queued
+     * @param count number of values
+     * @param status closed or full if not all values enqueued
+     * @return number of values enqueued
+     *
+     * @note
+     * The head is only reloaded when the local copy says the queue
+     * is full, and the tail is stored once for the whole run.
+     */
+    uint32_t enqueue_sp_bulk(const uintptr_t* values, uint32_t count, lfrbq_status& status)
+    {
+        seq_t tail_copy = tail.load(std::memory_order_acquire);   // always current
+
+        uint32_t n = 0;
+        for (; n < count; n++)
+        {
+            seq_t pos = tail_copy + n;
+
+            unsigned int ndx = seq2ndx(pos);
+            node_t *node = &rnode(ndx);
+
+            seq_t node_seq = node->load_seq(pos, std::memory_order_relaxed);
+
+            if (node_seq & Q_CLOSED) {
+                status = lfrbq_status::closed;
+                break;
+            }
+
+            if (node_seq != seq2node(pos)) {
+                status = lfrbq_status::full;
+                break;
+            }
+
+            if (pos == head_cache) {
+                head_cache = head.load(std::memory_order_acquire);
+                if (pos == head_cache) {
+                    status = lfrbq_status::full;
+                    break;
+                }
+            }
+
+            node->store(node_seq + (seq_t) capacity, values[n]);
+            prefetch_next<1>(pos + 1);
+        }
+
+        if (n > 0)
+            tail.store(tail_copy + n, std::memory_order_release);
+
+        return n;
+    }
+
+    /**
+     * @brief enqueue run of values, multi-producer
+     * @param values to be queued
+     * @param count number of values
+     * @param status closed or full if not all values enqueued
+     * @return number of values enqueued
+     *
+     * @note
+     * Same node scan as update_node() but w/ a local copy of the tail
+     * that is carried from one node to the next.  The head is only
+     * reloaded when the local tail catches up with it, and the shared
+     * tail is only updated once at the end of the run.
+     */
+    uint32_t enqueue_mp_bulk(const uintptr_t* values, uint32_t count, lfrbq_status& status)
+    {
+        seq_t tail_copy = tail.load(std::memory_order_relaxed);
+        seq_t head_copy = 0;
+        bool head_loaded = false;
+
+        uint32_t n = 0;
+        while (n < count)
+        {
+            unsigned int ndx = seq2ndx(tail_copy);
+            seq_t node_seq = rnode(ndx).load_seq(tail_copy, std::memory_order_relaxed);
+            if (node_seq & Q_CLOSED) {
+                status = lfrbq_status::closed;
+                break;
+            }
+
+            if (xcmp(node_seq + ndx, tail_copy) > 0) {      // seq > tail, node in use
+                uint64_t tail_latency = node_seq - seq2node(tail_copy);
+                if (tail_latency > capacity)
+                {
+                    count_stat(&lfrbq_stats_t::producer_wraps);
+                    tail_copy = (node_seq - capacity) + ndx;
+                }
+                else
+                {
+                    tail_copy++;
+                }
+                continue;
+            }
+
+            if (xcmp(node_seq, seq2node(tail_copy)) < 0)    // seq < tail, see update_node()
+            {
+                if (n > 0)
+                    break;
+                tail_copy = tail.load(std::memory_order_relaxed);
+                continue;
+            }
+
+            if (!head_loaded || xcmp(tail_copy, head_copy) >= 0)
+            {
+                std::atomic_thread_fence(std::memory_order_acquire);        // see update_node() note
+                head_copy = head.load(std::memory_order_relaxed);
+                head_loaded = true;
+
+                int64_t cc = xcmp(tail_copy, head_copy);
+                if (cc == 0) {
+                    status = lfrbq_status::full;
+                    break;
+                }
+
+                if (cc > 0) {
+                    count_stat(&lfrbq_stats_t::invalid_head_sync);
+                    abort();
+                    status = lfrbq_status::full;
+                    break;
+                }
+            }
+
+            // seq == tail
+            uintptr_t old_value = rnode(ndx).load_value(std::memory_order_relaxed);
+
+            if (rnode(ndx).compare_exchange(node_seq, old_value, node_seq + capacity, values[n]))
+            {
+                n++;
+                tail_copy++;
+            }
+            else
+            {
+                count_stat(&lfrbq_stats_t::producer_retries);
+            }
+        }
+
+        if (n > 0)
+            try_update_tail(tail_copy);
+
+        return n;
+    }
+
+    /**
+     * @brief dequeue run of values, single consumer
+     * @param values address for returned values
+     * @param count max number of values
+     * @return number of values dequeued
+     */
+    uint32_t dequeue_sc_bulk(uintptr_t *values, uint32_t count)
+    {
+        seq_t head_copy = head.load(std::memory_order_acquire);
+
+        uint32_t n = 0;
+
+        if (sp_mode)        // see dequeue_sc()
+        {
+            int64_t avail = xcmp(tail_cache + capacity, head_copy);
+            if (avail < count) {
+                tail_cache = tail.load(std::memory_order_acquire);
+                avail = xcmp(tail_cache + capacity, head_copy);
+            }
+            if (avail < count)
+                count = avail;
+
+            for (; n < count; n++)
+            {
+                seq_t pos = head_copy + n;
+                values[n] = rnode(seq2ndx(pos)).load_value(std::memory_order_relaxed);
+                prefetch_next<0>(pos + 1);
+            }
+        }
+        else
+        {
+            for (; n < count; n++)
+            {
+                seq_t pos = head_copy + n;
+                node_t *node = &rnode(seq2ndx(pos));
+
+                seq_t node_seq = node->load_seq(pos, std::memory_order_acquire) & ~Q_CLOSED;
+                if (node_seq != seq2node(pos))
+                    break;      // empty
+
+                values[n] = node->load_value(std::memory_order_relaxed);
+            }
+        }
+
+        if (n > 0)
+            head.store(head_copy + n, std::memory_order_release);
+
+        return n;
+    }
+
+    /**
+     * @brief dequeue run of values, multi-consumer
+     * @param values address for returned values
+     * @param count max number of values
+     * @return number of values dequeued
+     *
+     * @note
+     * The run of full nodes following the head is read and then
+     * claimed w/ a single head compare and swap.
+     */
+    uint32_t dequeue_mc_bulk(uintptr_t *values, uint32_t count)
+    {
+        seq_t head_copy = head.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            unsigned int ndx = seq2ndx(head_copy);
+
+            seq_t node_seq = rnode(ndx).load_seq(head_copy, std::memory_order_acquire) & ~Q_CLOSED;
+            int64_t cc = xcmp(node_seq, seq2node(head_copy));
+            if (cc < 0) {
+                return 0;       // seq < head  --  empty
+            }
+            else if (cc > 0) {  // seq > head  --  wrapped, reload head and retry
+                count_stat(&lfrbq_stats_t::consumer_wraps);
+                head_copy = head.load(std::memory_order_relaxed);
+                continue;
+            }
+
+            values[0] = rnode(ndx).load_value(std::memory_order_acquire);
+
+            uint32_t n = 1;
+            for (; n < count; n++)
+            {
+                seq_t pos = head_copy + n;
+                ndx = seq2ndx(pos);
+
+                node_seq = rnode(ndx).load_seq(pos, std::memory_order_acquire) & ~Q_CLOSED;
+                if (node_seq != seq2node(pos))
+                    break;
+
+                values[n] = rnode(ndx).load_value(std::memory_order_acquire);
+            }
+
+            if (head.compare_exchange_weak(head_copy, head_copy + n, std::memory_order_relaxed))
+                return n;
+
+            count_stat(&lfrbq_stats_t::consumer_retries);
+        }
+    }
+
+    /**
+     * @brief store a value at a claimed tail position, mpmc_faa mode
+     * @return false if the position has to be skipped
+     *
+     * @note
+     * The node can be used if its sequence isn't past the position, it has
+     * no value, and it's either safe or no dequeue has claimed the position yet.
+     */
+    bool put_faa(seq_t tail_copy, uintptr_t value)
+    {
+        node_t& node = rnode(seq2ndx(tail_copy));
+        for (;;)
+        {
+            seq_t node_seq = node.load_seq(tail_copy, std::memory_order_acquire);
+            uintptr_t old_value = node.load_value(std::memory_order_relaxed);
+
+            if ((node_seq & Q_FULL) || xcmp(seq2node(node_seq), seq2node(tail_copy)) > 0)
+                return false;   // in use or position already skipped by dequeue
+
+            if ((node_seq & Q_UNSAFE) && xcmp(head.load(std::memory_order_acquire), tail_copy + capacity) > 0)
+                return false;   // dequeue has claimed position
+
+            if (node.compare_exchange(node_seq, old_value, seq2node(tail_copy) | Q_FULL, value))
+                return true;
+        }
+    }
+
+    /**
+     * @brief take the value at a claimed head position, mpmc_faa mode
+     * @return false if the position is skipped
+     *
+     * @note
+     * A node w/o a value for the position has its sequence advanced a lap so
+     * a late enqueue can't use it.  A node still holding the value from an
+     * earlier lap is marked unsafe.
+     */
+    bool take_faa(seq_t head_copy, uintptr_t *value)
+    {
+        seq_t pos = head_copy - capacity;       // tail position for head
+        node_t& node = rnode(seq2ndx(head_copy));
+        for (;;)
+        {
+            seq_t node_seq = node.load_seq(pos, std::memory_order_acquire);
+            uintptr_t node_value = node.load_value(std::memory_order_acquire);
+
+            int64_t cc = xcmp(seq2node(node_seq), seq2node(pos));
+            if (cc > 0)
+                return false;   // position skipped by enqueue
+
+            if (!(node_seq & Q_FULL))
+            {
+                if (node.compare_exchange(node_seq, node_value, seq2node(head_copy) | (node_seq & Q_UNSAFE), node_value))
+                    return false;   // skip position
+            }
+            else if (cc == 0)
+            {
+                if (node.compare_exchange(node_seq, node_value, seq2node(head_copy) | (node_seq & Q_UNSAFE), node_value))
+                {
+                    *value = node_value;
+                    return true;
+                }
+            }
+            else
+            {
+                if (node.compare_exchange(node_seq, node_value, node_seq | Q_UNSAFE, node_value))
+                    return false;   // value from earlier lap, mark unsafe and skip position
+            }
+        }
+    }
+
+    /**
+     * @brief enqueue, mpmc_faa mode
+     *
+     * @note
+     * The tail position is claimed w/ fetch_add.  If the node can't be used
+     * the position is abandoned and the dequeue that claims it will skip it.
+     * The head is checked before the fetch_add so a full queue doesn't advance
+     * the tail.  After Q_FAA_SKIPS skipped positions the enqueue falls back to
+     * enqueue_faa_cas(), which a dequeue can't skip.
+     */
+    lfrbq_status enqueue_faa(uintptr_t value)
+    {
+        for (unsigned int skips = 0; skips < Q_FAA_SKIPS; skips++)
+        {
+            seq_t tail_copy = tail.load(std::memory_order_relaxed);
+            if (tail_copy & Q_TAIL_CLOSED)
+                return lfrbq_status::closed;
+            if (xcmp(tail_copy, head.load(std::memory_order_acquire)) >= 0)
+                return lfrbq_status::full;
+
+            tail_copy = tail.fetch_add(1, std::memory_order_acq_rel);
+            if (tail_copy & Q_TAIL_CLOSED)
+                return lfrbq_status::closed;
+
+            if (put_faa(tail_copy, value))
+                return lfrbq_status::success;
+
+            count_stat(&lfrbq_stats_t::producer_skips);
+            if (xcmp(tail_copy, head.load(std::memory_order_acquire)) >= 0)
+                return lfrbq_status::full;
+        }
+
+        return enqueue_faa_cas(value);
+    }
+
+    /**
+     * @brief enqueue w/o claiming the tail position first, mpmc_faa mode
+     *
+     * @note
+     * The value is stored in the node at the tail and the tail is then moved
+     * past it w/ a compare and swap, as in mpmc, so the position can't be
+     * skipped once it has the value.  A dequeue that claimed it before the
+     * tail moved takes the value.  A node that can't be used has the tail
+     * moved past it.  If the queue is closed between the store and the tail
+     * update, the value is taken back out unless a dequeue already has it.
+     */
+    lfrbq_status enqueue_faa_cas(uintptr_t value)
+    {
+        for (;;)
+        {
+            seq_t tail_copy = tail.load(std::memory_order_acquire);
+            if (tail_copy & Q_TAIL_CLOSED)
+                return lfrbq_status::closed;
+            if (xcmp(tail_copy, head.load(std::memory_order_acquire)) >= 0)
+                return lfrbq_status::full;
+
+            if (!put_faa(tail_copy, value))
+            {
+                count_stat(&lfrbq_stats_t::producer_retries);
+                tail.compare_exchange_strong(tail_copy, tail_copy + 1, std::memory_order_release, std::memory_order_relaxed);
+                continue;
+            }
+
+            seq_t expected = tail_copy;
+            if (tail.compare_exchange_strong(expected, tail_copy + 1, std::memory_order_release, std::memory_order_relaxed))
+                return lfrbq_status::success;
+            if (expected != (tail_copy | Q_TAIL_CLOSED))
+                return lfrbq_status::success;       // tail moved past the value
+
+            node_t& node = rnode(seq2ndx(tail_copy));
+            if (node.compare_exchange(seq2node(tail_copy) | Q_FULL, value, seq2node(tail_copy), value))
+                return lfrbq_status::closed;
+            return lfrbq_status::success;           // dequeued by a dequeue that claimed the position
+        }
+    }
+
+    /**
+     * @brief dequeue, mpmc_faa mode
+     *
+     * @note
+     * The head position is claimed w/ fetch_add.  The tail is checked before
+     * the fetch_add so an empty queue doesn't advance the head, and if the head
+     * does get past the tail, the tail is moved up to it.
+     */
+    bool dequeue_faa(uintptr_t *value)
+    {
+        for (;;)
+        {
+            seq_t head_copy = head.load(std::memory_order_relaxed);
+            if (xcmp(tail.load(std::memory_order_acquire) & ~Q_TAIL_CLOSED, head_copy - capacity) <= 0)
+                return false;   // empty
+
+            head_copy = head.fetch_add(1, std::memory_order_acq_rel);
+            if (take_faa(head_copy, value))
+                return true;
+
+            count_stat(&lfrbq_stats_t::consumer_skips);
+            if (xcmp(tail.load(std::memory_order_acquire) & ~Q_TAIL_CLOSED, head_copy - capacity + 1) <= 0)
+            {
+                fix_tail();
+                return false;   // empty
+            }
+        }
+    }
+
+    /**
+     * @brief move tail up to head if dequeues have claimed past it, mpmc_faa mode
+     */
+    void fix_tail()
+    {
+        for (;;)
+        {
+            seq_t tail_copy = tail.load(std::memory_order_acquire);
+            seq_t head_copy = head.load(std::memory_order_acquire);
+            if (tail.load(std::memory_order_relaxed) != tail_copy)
+                continue;
+
+            seq_t new_tail = head_copy - capacity;
+            if (xcmp(tail_copy & ~Q_TAIL_CLOSED, new_tail) >= 0)
+                return;
+
+            if (tail.compare_exchange_strong(tail_copy, new_tail | (tail_copy & Q_TAIL_CLOSED), std::memory_order_release))
+                return;
+        }
+    }
+
+    /**
+     * @brief enqueue run of values, mpmc_faa mode
+     *
+     * @note
+     * Each run of positions, up to the room left before the head, is claimed
+     * w/ one fetch_add.  Values go to the run's positions in order, skipping
+     * nodes that can't be used, and what's left goes to the next run.  After
+     * Q_FAA_SKIPS skipped positions the rest are enqueued w/ enqueue_faa_cas().
+     */
+    uint32_t enqueue_faa_bulk(const uintptr_t* values, uint32_t count, lfrbq_status& status)
+    {
+        uint32_t n = 0;
+        unsigned int skips = 0;
+        while (n < count)
+        {
+            if (skips >= Q_FAA_SKIPS)
+            {
+                status = enqueue_faa_cas(values[n]);
+                if (status != lfrbq_status::success)
+                    return n;
+                n++;
+                continue;
+            }
+
+            seq_t tail_copy = tail.load(std::memory_order_relaxed);
+            if (tail_copy & Q_TAIL_CLOSED)
+            {
+                status = lfrbq_status::closed;
+                return n;
+            }
+            int64_t room = xcmp(head.load(std::memory_order_acquire), tail_copy);
+            if (room <= 0)
+            {
+                status = lfrbq_status::full;
+                return n;
+            }
+
+            uint32_t run = std::min<int64_t>(count - n, room);
+            tail_copy = tail.fetch_add(run, std::memory_order_acq_rel);
+            if (tail_copy & Q_TAIL_CLOSED)
+            {
+                status = lfrbq_status::closed;
+                return n;
+            }
+
+            for (uint32_t k = 0; k < run; k++)
+            {
+                if (put_faa(tail_copy + k, values[n]))
+                    n++;
+                else
+                {
+                    skips++;
+                    count_stat(&lfrbq_stats_t::producer_skips);
+                }
+            }
+        }
+        return n;
+    }
+
+    /**
+     * @brief dequeue run of values, mpmc_faa mode
+     *
+     * @note
+     * Each run of positions, up to the values before the tail, is claimed w/
+     * one fetch_add, and the values of the positions not skipped are taken in
+     * order.  If the head gets past the tail the tail is moved up to it.
+     */
+    uint32_t dequeue_faa_bulk(uintptr_t *values, uint32_t count)
+    {
+        uint32_t n = 0;
+        while (n < count)
+        {
+            seq_t head_copy = head.load(std::memory_order_relaxed);
+            int64_t avail = xcmp(tail.load(std::memory_order_acquire) & ~Q_TAIL_CLOSED, head_copy - capacity);
+            if (avail <= 0)
+                break;      // empty
+
+            uint32_t run = std::min<int64_t>(count - n, avail);
+            head_copy = head.fetch_add(run, std::memory_order_acq_rel);
+            for (uint32_t k = 0; k < run; k++)
+            {
+                if (take_faa(head_copy + k, &values[n]))
+                    n++;
+                else
+                    count_stat(&lfrbq_stats_t::consumer_skips);
+            }
+
+            if (xcmp(tail.load(std::memory_order_acquire) & ~Q_TAIL_CLOSED, head_copy + run - capacity) <= 0)
+            {
+                fix_tail();
+                break;      // empty
+            }
+        }
+        return n;
+    }
+
 public:
 
     /**
@@ -450,18 +1250,61 @@ public:
     {
         qclosed.store(true, std::memory_order_release);
 
-        if (sp_mode)
+        if (faa_mode)
         {
-            seq_t tail_copy = tail.load(std::memory_order_relaxed);
-            unsigned int ndx = seq2ndx(tail_copy);
-            rbuffer[ndx].seq.fetch_or(Q_CLOSED, std::memory_order_release);
+            tail.fetch_or(Q_TAIL_CLOSED, std::memory_order_release);
         }
-        else
+        else if constexpr (!faa_only)
         {
-            update_node(false, &lfrbq::set_closed);
+            if (sp_mode)
+            {
+                seq_t tail_copy = tail.load(std::memory_order_relaxed);
+                unsigned int ndx = seq2ndx(tail_copy);
+                rnode(ndx).set_closed();
+            }
+            else
+            {
+                update_node(false, &lfrbq::set_closed);
+            }
         }
     }
 
+    /**
+     * @brief queue statistics, summed over all threads
+     */
+    lfrbq_stats_t stats() const { return stats_counter.snapshot(); }
+
+    /**
+     * @brief count into another queue's statistics counters from now on
+     *
+     * For queues made of lfrbq's, e.g. prbq lanes, so they count into the
+     * containing queue's counters.
+     */
+    void share_stats(const lfrbq_stats& counter) { stats_counter.share(counter); }
+
+    /**
+     * @brief approximate number of values in the queue
+     * @return number of values, 0 to capacity
+     *
+     * @note
+     * Computed from the head and tail w/o locking, safe to call concurrently
+     * w/ enqueues and dequeues.  The head and tail are loaded separately and
+     * a multi-producer tail can lag the nodes, so the value is only exact
+     * when the queue is quiescent.  Out of range values from concurrent
+     * updates are clamped.
+     */
+    uint32_t size()
+    {
+        seq_t head_copy = head.load(std::memory_order_acquire);
+        seq_t tail_copy = tail.load(std::memory_order_acquire) & ~Q_TAIL_CLOSED;
+        int64_t n = xcmp(tail_copy + capacity, head_copy);
+        if (n <= 0)
+            return 0;
+        if (n >= capacity)
+            return capacity;
+        return n;
+    }
+
     /**
      * @brief get queue closed status
      * @retval true queue is closed
@@ -469,6 +1312,37 @@ public:
      */
     bool closed() { return qclosed.load(std::memory_order_acquire); }
 
+    /**
+     * @brief get queue closed and drained status
+     * @retval true queue is closed and all values have been dequeued
+     * @retval false queue is open, has values, or an enqueue started
+     *         before the close may still complete
+     *
+     * @note
+     * closed() is set before the close marker, the node close bit or the
+     * mpmc_faa tail close bit, is set, so an enqueue can still complete after
+     * closed() is true.  No enqueue can complete past the marker, so the queue is
+     * drained when the head reaches it.
+     */
+    bool drained()
+    {
+        if (faa_mode)
+        {
+            seq_t tail_copy = tail.load(std::memory_order_acquire);
+            if ((tail_copy & Q_TAIL_CLOSED) == 0)
+                return false;
+            return xcmp(tail_copy & ~Q_TAIL_CLOSED, head.load(std::memory_order_acquire) - capacity) <= 0;
+        }
+        else
+        {
+            seq_t head_copy = head.load(std::memory_order_acquire);
+            seq_t node_seq = rnode(seq2ndx(head_copy)).load_seq(head_copy, std::memory_order_acquire);
+            if (head.load(std::memory_order_acquire) != head_copy)
+                return false;       // node may be for a later head
+            return (node_seq & Q_CLOSED) && (node_seq & ~Q_CLOSED) != seq2node(head_copy);
+        }
+    }
+
     /**
      * @brief enqueue a value
      * @param value to be queued
@@ -478,11 +1352,15 @@ public:
      */
     lfrbq_status try_enqueue(uintptr_t value)
     {
-        lfrbq_status status = sp_mode ? enqueue_sp(value) : enqueue_mp(value);
+        lfrbq_status status;
+        if constexpr (faa_only)
+            status = enqueue_faa(value);
+        else
+            status = faa_mode ? enqueue_faa(value) : sp_mode ? enqueue_sp(value) : enqueue_mp(value);
         switch (status)
         {
             case lfrbq_status::full:
-                tls_lfrbq_stats.queue_full_count++;
+                count_stat(&lfrbq_stats_t::queue_full_count);
         }
         return status;
     }
@@ -496,19 +1374,52 @@ public:
      */
     lfrbq_status try_dequeue(uintptr_t *value)
     {
-        bool _closed = closed();
-
-        if (sc_mode ? dequeue_sc(value) : dequeue_mc(value))
+        if (faa_mode ? dequeue_faa(value) : sc_mode ? dequeue_sc(value) : dequeue_mc(value))
             return lfrbq_status::success;
-        else if (_closed)
+        else if (closed() && drained())
             return lfrbq_status::closed;
         else
         {
-            tls_lfrbq_stats.queue_empty_count++;
+            count_stat(&lfrbq_stats_t::queue_empty_count);
             return lfrbq_status::empty;
         }
     }
 
+    /**
+     * @brief enqueue multiple values
+     * @param values to be queued
+     * @param count number of values
+     * @return number of values enqueued, less than count if queue full or closed
+     */
+    uint32_t try_enqueue_bulk(const uintptr_t* values, uint32_t count)
+    {
+        if (count == 0)
+            return 0;
+
+        lfrbq_status status = lfrbq_status::success;
+        uint32_t n = faa_mode ? enqueue_faa_bulk(values, count, status) : sp_mode ? enqueue_sp_bulk(values, count, status) : enqueue_mp_bulk(values, count, status);
+        if (status == lfrbq_status::full)
+            count_stat(&lfrbq_stats_t::queue_full_count);
+        return n;
+    }
+
+    /**
+     * @brief dequeue multiple values
+     * @param values address for returned values
+     * @param count max number of values
+     * @return number of values dequeued, 0 if queue empty or closed
+     */
+    uint32_t try_dequeue_bulk(uintptr_t *values, uint32_t count)
+    {
+        if (count == 0)
+            return 0;
+
+        uint32_t n = faa_mode ? dequeue_faa_bulk(values, count) : sc_mode ? dequeue_sc_bulk(values, count) : dequeue_mc_bulk(values, count);
+        if (n == 0 && !(closed() && drained()))
+            count_stat(&lfrbq_stats_t::queue_empty_count);
+        return n;
+    }
+
 
 };
 
@@ -0,0 +1,180 @@
+/*
+   Copyright 2025 Joseph W. Seigh
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <new>
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+
+
+/**
+ * @brief ring buffer page type
+ */
+enum lfrbq_pages
+{
+    default_pages = 0,  // aligned_alloc, 4K pages
+    thp_pages = 1,      // mmap, 2M aligned, madvise(MADV_HUGEPAGE)
+    huge_2m = 2,        // mmap MAP_HUGETLB 2M pages, must be reserved
+    huge_1g = 3,        // mmap MAP_HUGETLB 1G pages, must be reserved
+};
+
+/**
+ * @brief ring buffer NUMA memory policy
+ */
+enum lfrbq_numa
+{
+    numa_default = 0,       // first touch
+    numa_bind = 1,          // bind to numa_nodes
+    numa_interleave = 2,    // interleave across numa_nodes
+};
+
+/**
+ * @brief ring buffer allocation options
+ *
+ * Anything other than the defaults allocates the ring buffer w/ mmap.  mmap'd
+ * memory is already zero so the nodes aren't initialized by the ctor, and the
+ * pages are placed by whichever thread first touches them unless prefault is
+ * set or a NUMA policy is given.
+ */
+struct lfrbq_alloc_options
+{
+    lfrbq_pages pages = default_pages;
+    lfrbq_numa numa = numa_default;
+    uint64_t numa_nodes = ~(uint64_t) 0;    // node mask for numa_bind or numa_interleave
+    bool prefault = false;                  // touch all pages at allocation
+};
+
+
+/**
+ * @brief ring buffer memory
+ */
+struct lfrbq_buffer
+{
+    void* addr = nullptr;
+    size_t size = 0;        // mapped size, 0 if not mmap'd
+    bool zeroed = false;    // memory known to be zero
+};
+
+
+/**
+ * @brief allocate ring buffer memory
+ * @param sz size in bytes
+ * @param options allocation options
+ * @return buffer, 64 byte aligned
+ * @throws bad_alloc if memory or huge pages can't be allocated or
+ *         the NUMA policy can't be set
+ */
+inline lfrbq_buffer lfrbq_alloc_buffer(size_t sz, const lfrbq_alloc_options& options)
+{
+    lfrbq_buffer buffer;
+
+    if (options.pages == default_pages && options.numa == numa_default)
+    {
+        buffer.addr = aligned_alloc(64, (sz + 63) & ~(size_t) 63);
+        if (buffer.addr == nullptr)
+            throw std::bad_alloc();
+        if (options.prefault)
+            memset(buffer.addr, 0, sz);
+        return buffer;
+    }
+
+    size_t page_size;
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    switch (options.pages)
+    {
+        case huge_2m:
+            page_size = (size_t) 1 << 21;
+            flags |= MAP_HUGETLB | (21 << MAP_HUGE_SHIFT);
+            break;
+        case huge_1g:
+            page_size = (size_t) 1 << 30;
+            flags |= MAP_HUGETLB | (30 << MAP_HUGE_SHIFT);
+            break;
+        case thp_pages:
+            page_size = (size_t) 1 << 21;
+            break;
+        default:
+            page_size = sysconf(_SC_PAGESIZE);
+            break;
+    }
+
+    size_t map_size = (sz + page_size - 1) & ~(page_size - 1);
+
+    void* addr;
+    if (options.pages == thp_pages)
+    {
+        // over map and trim so the buffer is 2M aligned for THP
+        char* p = (char*) mmap(nullptr, map_size + page_size, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (p == MAP_FAILED)
+            throw std::bad_alloc();
+        char* q = (char*) (((uintptr_t) p + page_size - 1) & ~(page_size - 1));
+        if (q > p)
+            munmap(p, q - p);
+        munmap(q + map_size, p + page_size - q);
+        addr = q;
+        madvise(addr, map_size, MADV_HUGEPAGE);
+    }
+    else
+    {
+        addr = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (addr == MAP_FAILED)
+            throw std::bad_alloc();
+    }
+
+    if (options.numa != numa_default)
+    {
+        int mode = options.numa == numa_bind ? MPOL_BIND : MPOL_INTERLEAVE;
+        unsigned long nodemask = options.numa_nodes;
+        if (syscall(SYS_mbind, addr, map_size, mode, &nodemask, sizeof(nodemask) * 8, 0) != 0)
+        {
+            munmap(addr, map_size);
+            throw std::bad_alloc();
+        }
+    }
+
+    if (options.prefault)
+        memset(addr, 0, map_size);
+
+    buffer.addr = addr;
+    buffer.size = map_size;
+    buffer.zeroed = true;
+    return buffer;
+}
+
+/**
+ * @brief free ring buffer memory
+ */
+inline void lfrbq_free_buffer(lfrbq_buffer& buffer)
+{
+    if (buffer.size != 0)
+        munmap(buffer.addr, buffer.size);
+    else
+        free(buffer.addr);
+    buffer.addr = nullptr;
+}
+
+/*==*/
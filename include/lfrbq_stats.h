@@ -0,0 +1,298 @@
+/*
+   Copyright 2025 Joseph W. Seigh
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+
+#include <stdint.h>
+#include <unistd.h>
+
+/*
+ * LFRBQ_STATS=0 compiles the statistics counters out of the queues
+ */
+#ifndef LFRBQ_STATS
+#define LFRBQ_STATS 1
+#endif
+
+constexpr bool lfrbq_stats_enabled = (LFRBQ_STATS != 0);
+
+
+/**
+ * @brief queue statistics
+ *
+ * waits are counts of yield(), eventcount.wait(), or cvar.wait()
+ */
+struct lfrbq_stats_t {
+    uint64_t queue_full_count = 0;      // queue full count
+    uint64_t queue_empty_count = 0;     // queue empty count
+
+    uint64_t producer_waits = 0;        // rbq enqueue waits for non-full queue
+    uint64_t consumer_waits = 0;        // rbq dequeue  waits for non-empty queue
+
+    uint64_t producer_retries = 0;      // producer atomic op retries
+    uint64_t consumer_retries = 0;      // consumer atomic op retries
+
+    uint64_t producer_skips = 0;        // mpmc_faa tail positions abandoned by producer
+    uint64_t consumer_skips = 0;        // mpmc_faa head positions w/o a value
+
+    uint64_t producer_wraps = 0;        // producer detected wraps
+    uint64_t consumer_wraps = 0;        // consumer detected wraps
+
+    uint64_t consumer_steals = 0;       // srbq dequeues from other than the local shard
+
+    uint64_t spin_resolved = 0;         // rbq adaptive waits resolved while spinning
+    uint64_t yield_resolved = 0;        // rbq adaptive waits resolved while yielding
+    uint64_t park_resolved = 0;         // rbq adaptive waits resolved after parking on an eventcount
+
+    uint64_t invalid_head_sync = 0;     // head observed by producer w/ staler value than it should have been
+
+    lfrbq_stats_t& operator +=(const lfrbq_stats_t& other)
+    {
+        constexpr size_t n = sizeof(lfrbq_stats_t) / sizeof(uint64_t);
+        uint64_t* a = (uint64_t*) this;
+        const uint64_t* b = (const uint64_t*) &other;
+        for (size_t ndx = 0; ndx < n; ndx++)
+            a[ndx] += std::atomic_ref<const uint64_t>(b[ndx]).load(std::memory_order_relaxed);
+        return *this;
+    }
+};
+
+
+/**
+ * @brief process wide registry of per queue, per thread statistics
+ *
+ * Each queue has an id and each thread that counts something for a queue
+ * gets its own block of counters for that id, so counting is a plain load and
+ * store w/o any shared cache lines.  A thread finds its block through a small
+ * direct mapped thread local cache, backed by a thread local map of all the
+ * ids it has counted for, and only searches the registry the first time it
+ * counts for an id.  snapshot() sums the blocks of all threads for an id.
+ *
+ * Blocks are in a list that's only ever pushed onto, w/o locking.  A new
+ * block is pushed w/ a compare and swap, and unregister_id() frees a queue's
+ * blocks for reuse by other ids rather than unlinking them, so lookups,
+ * snapshots, and unregistering never lock.
+ *
+ * Ids are never reused, the process id is in the high bits so the id of a
+ * queue in shared memory doesn't collide w/ ids in other processes.  Counters
+ * of threads that have exited are kept until the queue's id is unregistered.
+ */
+class lfrbq_stats_registry
+{
+    struct alignas(64) block
+    {
+        lfrbq_stats_t stats;
+        std::atomic<uint64_t> id = 0;           // 0 if free
+        std::atomic<bool> in_use = false;       // claimed, id may not be set yet
+        std::thread::id thread;                 // set before id
+        block* next = nullptr;                  // set before block is pushed
+    };
+
+    struct cache_entry      // thread local, zero initialized
+    {
+        uint64_t id;
+        lfrbq_stats_t* stats;
+    };
+
+    static constexpr unsigned int cache_size = 16;      // power of 2
+    static constexpr size_t max_ids = 1024;             // thread local map size that clears it
+
+    inline static thread_local cache_entry cache[cache_size];
+    inline static thread_local std::unordered_map<uint64_t, lfrbq_stats_t*> ids;
+
+    std::atomic<block*> blocks = nullptr;
+    std::atomic<uint32_t> next_id = 1;
+
+    /**
+     * @brief find this thread's block for an id, or claim a free one, or push a new one
+     */
+    lfrbq_stats_t* lookup(uint64_t id)
+    {
+        std::thread::id self = std::this_thread::get_id();
+
+        block* head = blocks.load(std::memory_order_acquire);
+        for (block* b = head; b != nullptr; b = b->next)
+            if (b->id.load(std::memory_order_acquire) == id && b->thread == self)
+                return &b->stats;
+
+        for (block* b = head; b != nullptr; b = b->next)
+        {
+            bool expected = false;
+            if (!b->in_use.load(std::memory_order_relaxed)
+                && b->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire))
+            {
+                b->thread = self;
+                b->id.store(id, std::memory_order_release);
+                return &b->stats;
+            }
+        }
+
+        block* b = new block();
+        b->in_use.store(true, std::memory_order_relaxed);
+        b->thread = self;
+        b->id.store(id, std::memory_order_relaxed);
+        b->next = head;
+        while (!blocks.compare_exchange_weak(b->next, b, std::memory_order_release, std::memory_order_relaxed))
+            ;
+        return &b->stats;
+    }
+
+public:
+
+    /**
+     * @brief the registry, never destroyed so queues can outlive static destructors
+     */
+    static lfrbq_stats_registry& instance()
+    {
+        static lfrbq_stats_registry* registry = new lfrbq_stats_registry();
+        return *registry;
+    }
+
+    /**
+     * @brief new queue id
+     */
+    uint64_t register_id()
+    {
+        return ((uint64_t) getpid() << 32) | next_id.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief zero and free the counters for a queue id
+     *
+     * Threads' cache entries for the id are left as is, since the id is
+     * never looked up again.
+     */
+    void unregister_id(uint64_t id)
+    {
+        for (block* b = blocks.load(std::memory_order_acquire); b != nullptr; b = b->next)
+        {
+            if (b->id.load(std::memory_order_acquire) != id)
+                continue;
+            b->id.store(0, std::memory_order_relaxed);
+            uint64_t* a = (uint64_t*) &b->stats;
+            for (size_t ndx = 0; ndx < sizeof(lfrbq_stats_t) / sizeof(uint64_t); ndx++)
+                std::atomic_ref<uint64_t>(a[ndx]).store(0, std::memory_order_relaxed);
+            b->in_use.store(false, std::memory_order_release);
+        }
+    }
+
+    /**
+     * @brief this thread's counters for a queue id
+     */
+    static lfrbq_stats_t& local(uint64_t id)
+    {
+        cache_entry& entry = cache[id & (cache_size - 1)];
+        if (entry.id != id)
+        {
+            auto it = ids.find(id);
+            if (it == ids.end())
+            {
+                if (ids.size() >= max_ids)
+                    ids.clear();        // mostly ids of destroyed queues, live ones are found again by lookup()
+                it = ids.emplace(id, instance().lookup(id)).first;
+            }
+            entry.stats = it->second;
+            entry.id = id;
+        }
+        return *entry.stats;
+    }
+
+    /**
+     * @brief sum of all threads' counters for a queue id
+     */
+    lfrbq_stats_t snapshot(uint64_t id)
+    {
+        lfrbq_stats_t sum;
+        for (block* b = blocks.load(std::memory_order_acquire); b != nullptr; b = b->next)
+            if (b->id.load(std::memory_order_acquire) == id)
+                sum += b->stats;
+        return sum;
+    }
+};
+
+
+/**
+ * @brief a queue's statistics counters
+ *
+ * Queues made of other queues, ulfrbq segments, prbq lanes, and srbq
+ * shards, share the counters of the containing queue.
+ */
+class lfrbq_stats_counter
+{
+    uint64_t id;
+    bool owner = true;
+
+public:
+
+    lfrbq_stats_counter() : id(lfrbq_stats_registry::instance().register_id()) {}
+
+    ~lfrbq_stats_counter()
+    {
+        if (owner)
+            lfrbq_stats_registry::instance().unregister_id(id);
+    }
+
+    lfrbq_stats_counter(const lfrbq_stats_counter&) = delete;
+    lfrbq_stats_counter& operator =(const lfrbq_stats_counter&) = delete;
+
+    /**
+     * @brief count into other's counters from now on
+     */
+    void share(const lfrbq_stats_counter& other)
+    {
+        if (owner)
+            lfrbq_stats_registry::instance().unregister_id(id);
+        id = other.id;
+        owner = false;
+    }
+
+    /**
+     * @brief add to this thread's counter
+     * @param counter lfrbq_stats_t member
+     */
+    inline void count(uint64_t lfrbq_stats_t::* counter, uint64_t n = 1)
+    {
+        uint64_t& value = lfrbq_stats_registry::local(id).*counter;
+        std::atomic_ref<uint64_t>(value).store(value + n, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief sum of all threads' counters
+     */
+    lfrbq_stats_t snapshot() const { return lfrbq_stats_registry::instance().snapshot(id); }
+};
+
+
+/**
+ * @brief statistics counters compiled out
+ */
+struct lfrbq_stats_none
+{
+    void share(const lfrbq_stats_none&) {}
+    inline void count(uint64_t lfrbq_stats_t::*, uint64_t n = 1) {}
+    lfrbq_stats_t snapshot() const { return {}; }
+};
+
+/**
+ * @brief statistics counters per LFRBQ_STATS
+ */
+using lfrbq_stats = std::conditional_t<lfrbq_stats_enabled, lfrbq_stats_counter, lfrbq_stats_none>;
+
+/*==*/
@@ -0,0 +1,314 @@
+/*
+   Copyright 2025 Joseph W. Seigh
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <new>
+#include <stdexcept>
+
+#include <stdint.h>
+
+#include <lfrbq.h>
+#include <eventcount.h>
+
+
+/**
+ * @brief lock-free blocking priority queue
+ * @tparam qtype lane queue type, see lfrbq
+ * @tparam node_t lane ring buffer node type, see lfrbq
+ *
+ * One lfrbq lane per priority level, priority 0 is the highest.  Values are
+ * FIFO w/in a lane, and dequeue takes from the highest priority non-empty
+ * lane.  An occupancy bitmap w/ a bit per lane is set by producers after
+ * they enqueue, and cleared by consumers that find the lane empty, so dequeue
+ * goes straight to the first non-empty lane instead of probing each one.
+ *
+ * Blocking uses one pair of eventcounts for the whole queue, so a consumer
+ * waits once for a value on any lane.  A producer waits for its lane to be
+ * non-full on the same consumer eventcount, which is posted by a dequeue
+ * from any lane.
+ */
+template<lfrbq_type qtype = runtime_qtype, typename node_t = lfrbq_node>
+class prbq
+{
+    using lane_t = lfrbq<qtype, node_t>;
+
+    static constexpr unsigned int max_levels = 64;
+
+    alignas(64) std::atomic<uint64_t> occupied = 0;     // bit per lane that may be non-empty
+
+    alignas(64) event_count producer_eventcount;        // posted by producers, consumers wait
+    alignas(64) event_count consumer_eventcount;        // posted by consumers, producers wait
+
+    const unsigned int nlevels;
+    lane_t* lanes;
+
+    [[no_unique_address]] lfrbq_stats stats_counter;    // shared by all lanes
+
+    template<typename... Args>
+    void init(Args&&... args)
+    {
+        if (nlevels == 0 || nlevels > max_levels)
+            throw std::invalid_argument("levels not in 1..64");
+
+        lanes = (lane_t*) ::operator new[](nlevels * sizeof(lane_t), std::align_val_t(alignof(lane_t)));
+        unsigned int ndx = 0;
+        try {
+            for (; ndx < nlevels; ndx++)
+            {
+                new (&lanes[ndx]) lane_t(args...);
+                lanes[ndx].share_stats(stats_counter);
+            }
+        }
+        catch (...) {
+            while (ndx > 0)
+                lanes[--ndx].~lane_t();
+            ::operator delete[](lanes, std::align_val_t(alignof(lane_t)));
+            throw;
+        }
+    }
+
+    unsigned int level(unsigned int prio) { return prio < nlevels ? prio : nlevels - 1; }
+
+    /**
+     * @brief mark lane non-empty after an enqueue
+     *
+     * The fence orders the enqueue before the bitmap load, so a consumer
+     * clearing the bit after this load sees the value when it rechecks the lane.
+     */
+    void set_occupied(unsigned int prio)
+    {
+        uint64_t bit = (uint64_t) 1 << prio;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if ((occupied.load(std::memory_order_relaxed) & bit) == 0)
+            occupied.fetch_or(bit, std::memory_order_release);
+    }
+
+    /**
+     * @brief closed and all lanes drained
+     */
+    bool drained()
+    {
+        if (!closed())
+            return false;
+        for (unsigned int ndx = 0; ndx < nlevels; ndx++)
+            if (!lanes[ndx].drained())
+                return false;
+        return true;
+    }
+
+public:
+
+    /**
+     * @brief create lock-free blocking priority queue
+     * @param levels number of priority levels, 1 to 64
+     * @param capacity of each lane, must be power of 2 and >= 2
+     * @param type lane queue type, one of mpmc, mpsc, spmc, spsc, or mpmc_faa
+     * @param layout lane ring buffer node layout
+     * @throws invalid_argument if levels out of range or capacity not power of 2 or less than 2
+     */
+    prbq(unsigned int levels, uint32_t capacity, lfrbq_type type, lfrbq_layout layout = linear_layout) requires (qtype == runtime_qtype) :
+        nlevels(levels)
+    {
+        init(capacity, type, layout);
+    }
+
+    /**
+     * @brief create lock-free blocking priority queue w/ lanes of type qtype
+     * @see prbq(unsigned int,uint32_t,lfrbq_type,lfrbq_layout)
+     */
+    prbq(unsigned int levels, uint32_t capacity, lfrbq_layout layout = linear_layout) requires (qtype != runtime_qtype) :
+        nlevels(levels)
+    {
+        init(capacity, layout);
+    }
+
+    ~prbq()
+    {
+        for (unsigned int ndx = 0; ndx < nlevels; ndx++)
+            lanes[ndx].~lane_t();
+        ::operator delete[](lanes, std::align_val_t(alignof(lane_t)));
+    }
+
+    prbq(const prbq&) = delete;
+    prbq& operator =(const prbq&) = delete;
+
+    /**
+     * @brief number of priority levels
+     */
+    unsigned int levels() { return nlevels; }
+
+    /**
+     * @brief close the queue, all lanes
+     */
+    void close()
+    {
+        for (unsigned int ndx = 0; ndx < nlevels; ndx++)
+            lanes[ndx].close();
+
+        producer_eventcount.close();
+        consumer_eventcount.close();
+    }
+
+    /**
+     * @brief get queue closed status
+     */
+    bool closed() { return lanes[0].closed(); }
+
+    /**
+     * @brief approximate number of values, summed over all lanes, see lfrbq::size()
+     */
+    uint32_t size()
+    {
+        uint32_t n = 0;
+        for (unsigned int ndx = 0; ndx < nlevels; ndx++)
+            n += lanes[ndx].size();
+        return n;
+    }
+
+    /**
+     * @brief queue statistics, summed over all threads and lanes
+     */
+    lfrbq_stats_t stats() const
+    {
+        return stats_counter.snapshot();
+    }
+
+    /**
+     * @brief enqueue a value
+     * @param value to be queued
+     * @param prio priority level, 0 is highest, levels past the last are the last
+     * @retval lfrbq_status::success enqueue succeeded
+     * @retval lfrbq_status::full    enqueue failed - lane full
+     * @retval lfrbq_status::closed  enqueue failed - queue closed
+     */
+    lfrbq_status try_enqueue(uintptr_t value, unsigned int prio)
+    {
+        prio = level(prio);
+        lfrbq_status status = lanes[prio].try_enqueue(value);
+        if (status == lfrbq_status::success)
+            set_occupied(prio);
+        return status;
+    }
+
+    /**
+     * @brief dequeue highest priority value
+     * @param value address for returned value
+     * @param prio address for returned value priority, optional
+     * @retval lfrbq_status::success dequeue succeeded
+     * @retval lfrbq_status::empty   dequeue failed - queue empty
+     * @retval lfrbq_status::closed  dequeue failed - queue is empty and closed
+     *
+     * @note
+     * A lane found empty has its bit cleared and is checked again, so an
+     * enqueue that saw the bit still set before the clear isn't missed.
+     */
+    lfrbq_status try_dequeue(uintptr_t* value, unsigned int* prio = nullptr)
+    {
+        for (;;)
+        {
+            uint64_t bits = occupied.load(std::memory_order_acquire);
+            if (bits == 0)
+                return drained() ? lfrbq_status::closed : lfrbq_status::empty;
+
+            unsigned int ndx = __builtin_ctzll(bits);
+            uint64_t bit = (uint64_t) 1 << ndx;
+
+            if (lanes[ndx].try_dequeue(value) != lfrbq_status::success)
+            {
+                occupied.fetch_and(~bit, std::memory_order_seq_cst);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (lanes[ndx].try_dequeue(value) != lfrbq_status::success)
+                    continue;
+                occupied.fetch_or(bit, std::memory_order_relaxed);     // may have more values
+            }
+
+            if (prio != nullptr)
+                *prio = ndx;
+            return lfrbq_status::success;
+        }
+    }
+
+    /**
+     * @brief enqueue a value, blocks if lane is full
+     * @param value to be queued
+     * @param prio priority level, see try_enqueue
+     * @retval lfrbq_status::success enqueue succeeded
+     * @retval lfrbq_status::closed  enqueue failed - queue closed
+     */
+    lfrbq_status enqueue(uintptr_t value, unsigned int prio)
+    {
+        for (;;)
+        {
+            lfrbq_status status = try_enqueue(value, prio);
+            if (status != lfrbq_status::full)
+            {
+                if (status == lfrbq_status::success)
+                    producer_eventcount.post();
+                return status;
+            }
+
+            uint32_t mark = consumer_eventcount.mark();
+            status = try_enqueue(value, prio);
+            if (status != lfrbq_status::full)
+            {
+                consumer_eventcount.reset(mark);
+                if (status == lfrbq_status::success)
+                    producer_eventcount.post();
+                return status;
+            }
+            stats_counter.count(&lfrbq_stats_t::producer_waits);
+            consumer_eventcount.wait(mark);
+        }
+    }
+
+    /**
+     * @brief dequeue highest priority value, blocks if queue is empty and not closed
+     * @param value address for returned value
+     * @param prio address for returned value priority, optional
+     * @retval lfrbq_status::success dequeue succeeded
+     * @retval lfrbq_status::closed  dequeue failed - queue is empty and closed
+     */
+    lfrbq_status dequeue(uintptr_t* value, unsigned int* prio = nullptr)
+    {
+        for (;;)
+        {
+            lfrbq_status status = try_dequeue(value, prio);
+            if (status != lfrbq_status::empty)
+            {
+                if (status == lfrbq_status::success)
+                    consumer_eventcount.post();
+                return status;
+            }
+
+            uint32_t mark = producer_eventcount.mark();
+            status = try_dequeue(value, prio);
+            if (status != lfrbq_status::empty)
+            {
+                producer_eventcount.reset(mark);
+                if (status == lfrbq_status::success)
+                    consumer_eventcount.post();
+                return status;
+            }
+            stats_counter.count(&lfrbq_stats_t::consumer_waits);
+            producer_eventcount.wait(mark);
+        }
+    }
+
+};
+
+/*==*/
@@ -16,12 +16,18 @@
 
 #pragma once
 
+#include <algorithm>
+#include <chrono>
 #include <condition_variable>
+#include <coroutine>
 #include <mutex>
-#include <semaphore>
+#include <stdexcept>
 #include <thread>
+#include <type_traits>
 #include <lfrbq.h>
 #include <eventcount.h>
+#include <futex_semaphore.h>
+#include <eventfd_signal.h>
 
 /**
  * @brief rbq synchonization type for blocking on full/empty queues
@@ -32,59 +38,372 @@ enum rbq_sync
     mutex,          // use mutex and cvars
     yield,          // use yield()
     semaphore,      // use counting semaphores
-    atomic32        // use atomic wait/notify
+    atomic32,       // use 32 bit atomic and futex wait/wake
+    adaptive,       // spin, then yield(), then wait on eventcount
+    handoff,        // use eventcount, wake one waiter per value or slot instead of all
+    readiness,      // use eventfds, readable on empty to non-empty and full to non-full, for epoll
+    async,          // use eventcount, and resume coroutines suspended in async_enqueue()/async_dequeue()
+
+    runtime_sync = -1   // synchronization type set at runtime by ctor parameter
+};
+
+
+/**
+ * @brief synchronization type fixed at compile time
+ */
+template<rbq_sync stype>
+struct rbq_sync_mode
+{
+    static constexpr rbq_sync sync = stype;
+
+    /**
+     * @throws invalid_argument if type isn't stype
+     */
+    rbq_sync_mode(rbq_sync type)
+    {
+        if (type != stype)
+            throw std::invalid_argument("sync type doesn't match stype");
+    }
+};
+
+/**
+ * @brief synchronization type set at runtime
+ */
+template<>
+struct rbq_sync_mode<runtime_sync>
+{
+    const rbq_sync sync;
+
+    rbq_sync_mode(rbq_sync sync) : sync(sync) {}
+};
+
+/**
+ * @brief placeholder for synchronization objects not used by sync type
+ */
+struct rbq_none
+{
+    template<typename... Args>
+    constexpr rbq_none(Args&&...) {}
 };
 
-class rbq : public lfrbq
+/**
+ * @brief sync type stype uses the synchronization objects of sync type used
+ * adaptive parks on the eventcounts, handoff posts them differently, async
+ * blocks threads on them
+ */
+constexpr bool rbq_sync_uses(rbq_sync stype, rbq_sync used)
+{
+    return stype == used || stype == runtime_sync
+        || ((stype == rbq_sync::adaptive || stype == rbq_sync::handoff || stype == rbq_sync::async) && used == rbq_sync::eventcount);
+}
+
+/**
+ * @brief synchronization object of type T if used by sync type stype
+ */
+template<rbq_sync stype, rbq_sync used, typename T>
+using rbq_member = std::conditional_t<rbq_sync_uses(stype, used), T, rbq_none>;
+
+
+/**
+ * @brief rbq clock for timed enqueue and dequeue, CLOCK_MONOTONIC
+ */
+using rbq_clock = std::chrono::steady_clock;
+
+
+/**
+ * @brief rbq watermark callback
+ * @param arg callback argument from set_watermarks()
+ * @param high true if the queue reached the high watermark, false if it fell to the low watermark
+ * @param size queue size when the watermark was crossed
+ */
+using rbq_watermark_fn = void (*)(void* arg, bool high, uint32_t size);
+
+
+/**
+ * @brief rbq executor for resuming coroutines suspended in async_enqueue() or async_dequeue()
+ * @param arg executor argument from set_executor()
+ * @param handle coroutine to resume, the enqueue or dequeue is already done
+ */
+using rbq_resume_fn = void (*)(void* arg, std::coroutine_handle<> handle);
+
+
+/**
+ * @brief lock-free blocking queue
+ * @tparam qtype queue type, see lfrbq
+ * @tparam stype synchronization type or runtime_sync (the default) to set it w/ the ctor
+ * @tparam node_t ring buffer node type, see lfrbq
+ *
+ * A fixed synchronization type only has the eventcounts, mutexes, etc... used
+ * by that type, and enqueue/dequeue call the type's wait loop directly.
+ */
+template<lfrbq_type qtype = runtime_qtype, rbq_sync stype = runtime_sync, typename node_t = lfrbq_node>
+class rbq : public lfrbq<qtype, node_t>, protected rbq_sync_mode<stype>
 {
-    event_count producer_eventcount;
-    event_count consumer_eventcount;
+    using base = lfrbq<qtype, node_t>;
+
+public:
+
+    using base::try_enqueue;
+    using base::try_dequeue;
+    using base::try_enqueue_bulk;
+    using base::try_dequeue_bulk;
+
+private:
+
+    using rbq_sync_mode<stype>::sync;
+
+    /**
+     * @brief synchronization type s, or its synchronization objects, are compiled in
+     */
+    static constexpr bool uses(rbq_sync s) { return rbq_sync_uses(stype, s); }
+
+    /**
+     * @brief sync is eventcount, adaptive, handoff, or async, all post the eventcounts
+     */
+    bool posts_eventcounts() { return sync == rbq_sync::eventcount || sync == rbq_sync::adaptive || sync == rbq_sync::handoff || sync == rbq_sync::async; }
+
+    /**
+     * @brief post eventcount for n values or slots, handoff wakes n waiters, the others all
+     *
+     * A handoff queue waited on directly by an rbq_waitset wakes all waiters,
+     * since the waitset thread waits on the producer eventcount along w/ the
+     * dequeues and could take a wakeup meant for one of them.
+     */
+    void post(event_count& eventcount, uint32_t n = 1)
+    {
+        if (uses(rbq_sync::handoff) && sync == rbq_sync::handoff && !waitset_direct.load(std::memory_order_relaxed))
+            eventcount.post(n);
+        else
+            eventcount.post();
+    }
+
+    /*
+     * adaptive spin budget, in spins of a pause and a retry
+     */
+    static constexpr uint32_t adaptive_spin_min = 4;
+    static constexpr uint32_t adaptive_spin_max = 2048;
+    static constexpr uint32_t adaptive_spin_init = 64;
+    static constexpr unsigned int adaptive_yields = 4;      // yields before parking
+
+    [[no_unique_address]] rbq_member<stype, rbq_sync::eventcount, event_count> producer_eventcount;
+    [[no_unique_address]] rbq_member<stype, rbq_sync::eventcount, event_count> consumer_eventcount;
+
+    [[no_unique_address]] rbq_member<stype, rbq_sync::mutex, std::mutex> producer_mutex;
+    [[no_unique_address]] rbq_member<stype, rbq_sync::mutex, std::condition_variable> producer_cvar;
+    [[no_unique_address]] rbq_member<stype, rbq_sync::mutex, std::mutex> consumer_mutex;
+    [[no_unique_address]] rbq_member<stype, rbq_sync::mutex, std::condition_variable> consumer_cvar;
+
+    [[no_unique_address]] rbq_member<stype, rbq_sync::atomic32, std::atomic<uint32_t>> producer_atomic32{0};    // bumped by producers if consumers waiting
+    [[no_unique_address]] rbq_member<stype, rbq_sync::atomic32, std::atomic<uint32_t>> consumer_atomic32{0};    // bumped by consumers if producers waiting
+
+    /*
+     * mutex and atomic32 waiter counts, notify is skipped if there are none
+     */
+    using waiter_count = std::conditional_t<rbq_sync_uses(stype, rbq_sync::mutex) || rbq_sync_uses(stype, rbq_sync::atomic32), std::atomic<uint32_t>, rbq_none>;
+    [[no_unique_address]] waiter_count producer_waiters{0};     // producers waiting for non-full
+    [[no_unique_address]] waiter_count consumer_waiters{0};     // consumers waiting for non-empty
+
+    [[no_unique_address]] rbq_member<stype, rbq_sync::semaphore, futex_semaphore> empty_nodes{0};   // producer acquire, consumer release
+    [[no_unique_address]] rbq_member<stype, rbq_sync::semaphore, futex_semaphore> full_nodes{0};    // consumer acquire, producer release
+
+    [[no_unique_address]] rbq_member<stype, rbq_sync::adaptive, std::atomic<uint32_t>> producer_spin{adaptive_spin_init};  // enqueue spin budget
+    [[no_unique_address]] rbq_member<stype, rbq_sync::adaptive, std::atomic<uint32_t>> consumer_spin{adaptive_spin_init};  // dequeue spin budget
+
+    [[no_unique_address]] rbq_member<stype, rbq_sync::readiness, eventfd_signal> readable;   // signaled by producers if consumers armed
+    [[no_unique_address]] rbq_member<stype, rbq_sync::readiness, eventfd_signal> writable;   // signaled by consumers if producers armed
+
+    /**
+     * @brief coroutine suspended in async_enqueue() or async_dequeue(), part of its awaiter
+     */
+    struct async_waiter
+    {
+        async_waiter* next = nullptr;
+        std::coroutine_handle<> handle;
+        uintptr_t value = 0;                // enqueue value
+        uintptr_t* out = nullptr;           // dequeue value address
+        lfrbq_status status = lfrbq_status::fail;
+    };
+
+    /**
+     * @brief intrusive FIFO list of async waiters
+     */
+    struct async_list
+    {
+        async_waiter* head = nullptr;
+        async_waiter* tail = nullptr;
+
+        bool empty() { return head == nullptr; }
+
+        void push_back(async_waiter* waiter)
+        {
+            waiter->next = nullptr;
+            if (tail == nullptr)
+                head = waiter;
+            else
+                tail->next = waiter;
+            tail = waiter;
+        }
+
+        async_waiter* pop_front()
+        {
+            async_waiter* waiter = head;
+            head = waiter->next;
+            if (head == nullptr)
+                tail = nullptr;
+            return waiter;
+        }
+    };
+
+    [[no_unique_address]] rbq_member<stype, rbq_sync::async, std::mutex> async_mutex;               // async lists
+    [[no_unique_address]] rbq_member<stype, rbq_sync::async, async_list> async_producers;          // suspended in async_enqueue()
+    [[no_unique_address]] rbq_member<stype, rbq_sync::async, async_list> async_consumers;          // suspended in async_dequeue()
+    [[no_unique_address]] rbq_member<stype, rbq_sync::async, std::atomic<uint32_t>> async_waiters{0};  // both lists
+    rbq_resume_fn resume_fn = nullptr;
+    void* resume_arg = nullptr;
+
+    /*
+     * watermarks, high_watermark 0 if not set
+     */
+    uint32_t high_watermark = 0;
+    uint32_t low_watermark = 0;
+    rbq_watermark_fn watermark_fn = nullptr;
+    void* watermark_arg = nullptr;
+    std::atomic<bool> watermark_high = false;   // high watermark reached and low not reached since
+
+    /**
+     * @brief check queue size against watermarks after an enqueue or dequeue
+     *
+     * The state only changes at the high watermark going up and at the low
+     * watermark going down.  The state is changed w/ a CAS so one thread
+     * calls back per crossing, and rechecked since the size may have crossed
+     * back while the callback state was being changed.
+     */
+    inline void check_watermarks()
+    {
+        if (high_watermark == 0)
+            return;
 
-    std::mutex producer_mutex;
-    std::condition_variable producer_cvar;
-    std::mutex consumer_mutex;
-    std::condition_variable consumer_cvar;
+        for (;;)
+        {
+            bool high = watermark_high.load(std::memory_order_relaxed);
+            uint32_t n = this->size();
+            bool new_high = high ? n > low_watermark : n >= high_watermark;
+            if (new_high == high)
+                return;
+            if (watermark_high.compare_exchange_strong(high, new_high, std::memory_order_relaxed) && watermark_fn != nullptr)
+                watermark_fn(watermark_arg, new_high, n);
+        }
+    }
 
-    std::atomic<uint32_t> producer_atomic32 = 0;    // use atomic wait/notify
-    std::atomic<uint32_t> consumer_atomic32 = 0;    // use atomic wait/notify
+    std::atomic<event_count*> waitset_eventcount = nullptr;     // rbq_waitset to post after enqueues, see rbq_waitset
+    std::atomic<bool> waitset_direct = false;                   // waited on directly by an rbq_waitset, see post()
+    const bool shared = false;          // in process shared memory, see shmq
+
+    template<typename Q>
+    friend class rbq_waitset;
+
+    /**
+     * @brief post waitset after an enqueue or close
+     */
+    inline void post_waitset()
+    {
+        if (event_count* eventcount = waitset_eventcount.load(std::memory_order_acquire))
+            eventcount->post();
+    }
 
-    std::counting_semaphore<INT_MAX> empty_nodes{0};   // producer acquire, consumer release
-    std::counting_semaphore<INT_MAX> full_nodes{0};    // consumer acquire, producer release
+    void init(uint32_t size)
+    {
+        if constexpr (uses(rbq_sync::semaphore))
+            empty_nodes.release(size);
 
-    const rbq_sync sync = rbq_sync::eventcount;
+        if constexpr (uses(rbq_sync::readiness))
+            if (sync == rbq_sync::readiness)
+            {
+                readable.open();
+                writable.open();
+            }
+    }
 
 public:
-    // using lfrbq::lfrbq;
 
     /**
      * @brief create a lock-free blocking queue
-     * @param sync synchronization type {eventcount, yield, mutex}
+     * @param sync synchronization type {eventcount, mutex, yield, semaphore, atomic32, adaptive, handoff, readiness, async}
      * 
      * @see lfrb::lfrb(uint32_t,bool,bool)
      * 
      */
-    rbq(uint32_t size, bool sp_mode, bool sc_mode, rbq_sync sync) : lfrbq(size, sp_mode, sc_mode), sync(sync)
+    rbq(uint32_t size, bool sp_mode, bool sc_mode, rbq_sync sync, lfrbq_layout layout = linear_layout, const lfrbq_alloc_options& alloc = {}) requires (qtype == runtime_qtype && stype == runtime_sync) :
+        base(size, sp_mode, sc_mode, layout, alloc), rbq_sync_mode<stype>(sync)
     {
-        empty_nodes.release(size);
+        init(size);
     }
 
     /**
      * @brief create a lock-free blocking queue
-     * @param sync synchronization type {eventcount, yield, mutex}
+     * @param sync synchronization type {eventcount, mutex, yield, semaphore, atomic32, adaptive, handoff, readiness, async}
      * 
      * @see lfrb::lfrb(uint32_t,lfrbq_qtype)
      *
      */
-    rbq(uint32_t size, lfrbq_type qtype, rbq_sync sync) : lfrbq(size, qtype), sync(sync)
+    rbq(uint32_t size, lfrbq_type type, rbq_sync sync, lfrbq_layout layout = linear_layout, const lfrbq_alloc_options& alloc = {}) requires (qtype == runtime_qtype && stype == runtime_sync) :
+        base(size, type, layout, alloc), rbq_sync_mode<stype>(sync)
+    {
+        init(size);
+    }
+
+    /**
+     * @brief create a lock-free blocking queue of type qtype w/ synchronization type stype
+     *
+     * @see lfrb::lfrb(uint32_t)
+     */
+    explicit rbq(uint32_t size, lfrbq_layout layout = linear_layout, const lfrbq_alloc_options& alloc = {}) requires (qtype != runtime_qtype && stype != runtime_sync) :
+        base(size, layout, alloc), rbq_sync_mode<stype>(stype)
+    {
+        init(size);
+    }
+
+protected:
+
+    /**
+     * @brief create a lock-free blocking queue of type qtype w/ synchronization type stype
+     * on a caller owned ring buffer
+     * @param nodes ring buffer of size nodes, not freed by the queue
+     * @param shared queue is in process shared memory, eventcounts are process shared
+     *
+     * @see lfrbq::lfrbq(uint32_t,lfrbq_layout,node_t*)
+     */
+    rbq(uint32_t size, lfrbq_layout layout, node_t* nodes, bool shared) requires (qtype != runtime_qtype && stype != runtime_sync) :
+        base(size, layout, nodes), rbq_sync_mode<stype>(stype),
+        producer_eventcount(shared),
+        consumer_eventcount(shared),
+        shared(shared)
     {
-        empty_nodes.release(size);
+        init(size);
     }
 
 
 private:
 
 
-    lfrbq_status enqueue_ec(uintptr_t value)
+    /**
+     * @brief deadline passed
+     * @param deadline absolute time, or nullptr for none
+     */
+    static bool expired(const rbq_clock::time_point* deadline) { return deadline != nullptr && rbq_clock::now() >= *deadline; }
+
+    /**
+     * @brief eventcount wait w/ optional deadline
+     */
+    static void wait_ec(event_count& eventcount, uint32_t mark, const rbq_clock::time_point* deadline)
+    {
+        if (deadline == nullptr)
+            eventcount.wait(mark);
+        else if (!eventcount.waituntil(mark, *deadline))
+            eventcount.reset(mark);
+    }
+
+    lfrbq_status enqueue_ec(uintptr_t value, const rbq_clock::time_point* deadline)
     {
         for (;;)
         {
@@ -92,7 +411,7 @@ private:
             switch (status)
             {
                 case lfrbq_status::success:
-                    producer_eventcount.post();
+                    post(producer_eventcount);
                     return status;
                 case lfrbq_status::closed:
                     return status;
@@ -102,13 +421,16 @@ private:
                     break;
             }
 
+            if (expired(deadline))
+                return lfrbq_status::timedout;
+
             uint32_t mark = consumer_eventcount.mark();
             status = try_enqueue(value);
             switch (status)
             {
                 case lfrbq_status::success:
                     consumer_eventcount.reset(mark);
-                    producer_eventcount.post();
+                    post(producer_eventcount);
                     return status;
                 case lfrbq_status::closed:
                     return status;
@@ -118,12 +440,12 @@ private:
                 default:
                     break;
             }
-            tls_lfrbq_stats.producer_waits++;
-            consumer_eventcount.wait(mark);   
+            this->count_stat(&lfrbq_stats_t::producer_waits);
+            wait_ec(consumer_eventcount, mark, deadline);
         }
     }
 
-    lfrbq_status dequeue_ec(uintptr_t *value)
+    lfrbq_status dequeue_ec(uintptr_t *value, const rbq_clock::time_point* deadline)
     {
         for (;;)
         {
@@ -131,7 +453,7 @@ private:
             switch (status)
             {
                 case lfrbq_status::success:
-                    consumer_eventcount.post();
+                    post(consumer_eventcount);
                     return status;
                 case lfrbq_status::closed:
                     return status;
@@ -141,13 +463,16 @@ private:
                     break;
             }
 
+            if (expired(deadline))
+                return lfrbq_status::timedout;
+
             uint32_t mark = producer_eventcount.mark();
             status = try_dequeue(value);
             switch (status)
             {
                 case lfrbq_status::success:
                     producer_eventcount.reset(mark);
-                    consumer_eventcount.post();
+                    post(consumer_eventcount);
                     return status;
                 case lfrbq_status::closed:
                     return status;
@@ -157,12 +482,12 @@ private:
                 default:
                     break;
             }
-            tls_lfrbq_stats.consumer_waits++;
-            producer_eventcount.wait(mark);   
+            this->count_stat(&lfrbq_stats_t::consumer_waits);
+            wait_ec(producer_eventcount, mark, deadline);
         }
     }
 
-    lfrbq_status enqueue_x(uintptr_t value)
+    lfrbq_status enqueue_x(uintptr_t value, const rbq_clock::time_point* deadline)
     {
         for (;;)
         {
@@ -175,14 +500,16 @@ private:
 
                 case lfrbq_status::full:
                 default:
-                    tls_lfrbq_stats.producer_waits++;
+                    if (expired(deadline))
+                        return lfrbq_status::timedout;
+                    this->count_stat(&lfrbq_stats_t::producer_waits);
                     std::this_thread::yield();
                     break;
             }
         }
     }   
 
-    lfrbq_status dequeue_x(uintptr_t *value)
+    lfrbq_status dequeue_x(uintptr_t *value, const rbq_clock::time_point* deadline)
     {
         for (;;)
         {
@@ -195,15 +522,90 @@ private:
 
                 case lfrbq_status::empty:
                 default:
-                    tls_lfrbq_stats.consumer_waits++;
+                    if (expired(deadline))
+                        return lfrbq_status::timedout;
+                    this->count_stat(&lfrbq_stats_t::consumer_waits);
                     std::this_thread::yield();
                     break;
             }
         }
     }
 
-    lfrbq_status enqueue_mx(uintptr_t value)
+    /**
+     * @brief waiter registration for mutex and atomic32 sync, held until the
+     * enqueue or dequeue returns
+     *
+     * A waiter registers and then retries before waiting.  The notifier
+     * updates the queue, fences, and loads the waiter count, so either it
+     * sees the waiter or the waiter's retry sees the update.
+     */
+    struct waiter_registration
+    {
+        std::atomic<uint32_t>* waiters = nullptr;
+
+        bool registered() { return waiters != nullptr; }
+
+        void add(std::atomic<uint32_t>& count)
+        {
+            waiters = &count;
+            count.fetch_add(1, std::memory_order_seq_cst);
+        }
+
+        ~waiter_registration()
+        {
+            if (waiters != nullptr)
+                waiters->fetch_sub(1, std::memory_order_relaxed);
+        }
+    };
+
+    /**
+     * @brief any waiters after a queue update
+     */
+    static bool have_waiters(std::atomic<uint32_t>& waiters)
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return waiters.load(std::memory_order_relaxed) != 0;
+    }
+
+    /**
+     * @brief notify waiters on cvar, if there are any
+     * @param mutex the waiters' mutex
+     * @param cvar the waiters' cvar
+     * @param waiters the waiters' count
+     * @param all notify all waiters or just one
+     *
+     * Waiters hold their mutex from testing the queue until they wait,
+     * so locking it before the notify means a waiter has either not
+     * tested the queue yet or is already waiting, and the notify isn't lost.
+     * The caller must not hold the other mutex.
+     */
+    static void notify_mx(std::mutex& mutex, std::condition_variable& cvar, std::atomic<uint32_t>& waiters, bool all = true)
+    {
+        if (!have_waiters(waiters))
+            return;
+        {
+            std::lock_guard lk(mutex);
+        }
+        if (all)
+            cvar.notify_all();
+        else
+            cvar.notify_one();
+    }
+
+    /**
+     * @brief cvar wait w/ optional deadline
+     */
+    static void wait_mx(std::condition_variable& cvar, std::unique_lock<std::mutex>& lk, const rbq_clock::time_point* deadline)
+    {
+        if (deadline == nullptr)
+            cvar.wait(lk);
+        else
+            cvar.wait_until(lk, *deadline);
+    }
+
+    lfrbq_status enqueue_mx(uintptr_t value, const rbq_clock::time_point* deadline)
     {
+        waiter_registration waiter;
         std::unique_lock lk(producer_mutex);
         for (;;)
         {
@@ -211,22 +613,30 @@ private:
             switch (status)
             {
                 case lfrbq_status::success:
-                    consumer_cvar.notify_one();
+                    lk.unlock();
+                    notify_mx(consumer_mutex, consumer_cvar, consumer_waiters, false);
                     return status;
                 case lfrbq_status::closed:
                     return status;
 
                 case lfrbq_status::full:
                 default:
-                    tls_lfrbq_stats.producer_waits++;
-                    producer_cvar.wait(lk);
+                    if (!waiter.registered()) {
+                        waiter.add(producer_waiters);
+                        break;
+                    }
+                    if (expired(deadline))
+                        return lfrbq_status::timedout;
+                    this->count_stat(&lfrbq_stats_t::producer_waits);
+                    wait_mx(producer_cvar, lk, deadline);
                     break;
             }
         }
     }
 
-    lfrbq_status dequeue_mx(uintptr_t *value)
+    lfrbq_status dequeue_mx(uintptr_t *value, const rbq_clock::time_point* deadline)
     {
+        waiter_registration waiter;
         std::unique_lock lk(consumer_mutex);
         // std::unique_lock lk(producer_mutex);
         for (;;)
@@ -235,74 +645,110 @@ private:
             switch (status)
             {
                 case lfrbq_status::success:
-                    producer_cvar.notify_one();
+                    lk.unlock();
+                    notify_mx(producer_mutex, producer_cvar, producer_waiters, false);
                     return status;
                 case lfrbq_status::closed:
                     return status;
 
                 case lfrbq_status::empty:
                 default:
-                    tls_lfrbq_stats.consumer_waits++;
-                    consumer_cvar.wait(lk);
+                    if (!waiter.registered()) {
+                        waiter.add(consumer_waiters);
+                        break;
+                    }
+                    if (expired(deadline))
+                        return lfrbq_status::timedout;
+                    this->count_stat(&lfrbq_stats_t::consumer_waits);
+                    wait_mx(consumer_cvar, lk, deadline);
                     break;
             }
         }
     }
 
-    lfrbq_status enqueue_a32(uintptr_t value)
+    /**
+     * @brief bump atomic32 and wake its waiters, if there are any
+     * @param all wake all waiters or just one
+     */
+    static void notify_a32(std::atomic<uint32_t>& atomic32, std::atomic<uint32_t>& waiters, bool all)
     {
-        for (;;)
+        if (!have_waiters(waiters))
+            return;
+        atomic32.fetch_add(1, std::memory_order_seq_cst);
+        futex_wake((uint32_t*) &atomic32, all ? INT_MAX : 1);
+    }
+
+    /**
+     * @brief atomic32 futex wait w/ optional deadline
+     */
+    static void wait_a32(std::atomic<uint32_t>& atomic32, uint32_t mark, const rbq_clock::time_point* deadline)
+    {
+        if (deadline == nullptr)
+            futex_wait((uint32_t*) &atomic32, mark, nullptr);
+        else
         {
-            uint32_t mark = consumer_atomic32.load(std::memory_order_acquire);
-            lfrbq_status status = try_enqueue(value);
-            switch (status)
-            {
-                case lfrbq_status::success:
-                    producer_atomic32.fetch_add(1, std::memory_order_relaxed);
-                    producer_atomic32.notify_one();
-                    return status;
-                case lfrbq_status::closed:
-                    return status;
+            struct timespec timeout = monotonic_timespec(*deadline);
+            futex_wait_until((uint32_t*) &atomic32, mark, &timeout);
+        }
+    }
 
-                case lfrbq_status::full:
-                default:
-                    tls_lfrbq_stats.producer_waits++;
-                    consumer_atomic32.wait(mark);
+    lfrbq_status enqueue_a32(uintptr_t value, const rbq_clock::time_point* deadline)
+    {
+        lfrbq_status status = try_enqueue(value);
+        if (status == lfrbq_status::full && !futex_spin([&] { return (status = try_enqueue(value)) != lfrbq_status::full; }))
+        {
+            waiter_registration waiter;
+            waiter.add(producer_waiters);
+            for (;;)
+            {
+                uint32_t mark = consumer_atomic32.load(std::memory_order_seq_cst);
+                if ((status = try_enqueue(value)) != lfrbq_status::full)
                     break;
+                if (expired(deadline))
+                    return lfrbq_status::timedout;
+                this->count_stat(&lfrbq_stats_t::producer_waits);
+                wait_a32(consumer_atomic32, mark, deadline);
             }
         }
+
+        if (status == lfrbq_status::success)
+            notify_a32(producer_atomic32, consumer_waiters, false);
+        return status;
     }   
 
-    lfrbq_status dequeue_a32(uintptr_t *value)
+    lfrbq_status dequeue_a32(uintptr_t *value, const rbq_clock::time_point* deadline)
     {
-        for (;;)
+        lfrbq_status status = try_dequeue(value);
+        if (status == lfrbq_status::empty && !futex_spin([&] { return (status = try_dequeue(value)) != lfrbq_status::empty; }))
         {
-            uint32_t mark = producer_atomic32.load(std::memory_order_acquire);
-            lfrbq_status status = try_dequeue(value);
-            switch (status)
+            waiter_registration waiter;
+            waiter.add(consumer_waiters);
+            for (;;)
             {
-                case lfrbq_status::success:
-                    consumer_atomic32.fetch_add(1, std::memory_order_relaxed);
-                    consumer_atomic32.notify_one();
-                    return status;
-                case lfrbq_status::closed:
-                    return status;
-
-                case lfrbq_status::empty:
-                default:
-                    tls_lfrbq_stats.consumer_waits++;
-                    producer_atomic32.wait(mark);
+                uint32_t mark = producer_atomic32.load(std::memory_order_seq_cst);
+                if ((status = try_dequeue(value)) != lfrbq_status::empty)
                     break;
+                if (expired(deadline))
+                    return lfrbq_status::timedout;
+                this->count_stat(&lfrbq_stats_t::consumer_waits);
+                wait_a32(producer_atomic32, mark, deadline);
             }
         }
+
+        if (status == lfrbq_status::success)
+            notify_a32(consumer_atomic32, producer_waiters, false);
+        return status;
     }
 
-    lfrbq_status enqueue_sem(uintptr_t value)
+    lfrbq_status enqueue_sem(uintptr_t value, const rbq_clock::time_point* deadline)
     {
         if (!empty_nodes.try_acquire())
         {
-            tls_lfrbq_stats.producer_waits++;
-            empty_nodes.acquire();
+            this->count_stat(&lfrbq_stats_t::producer_waits);
+            if (deadline == nullptr)
+                empty_nodes.acquire();
+            else if (!empty_nodes.try_acquire_until(*deadline))
+                return lfrbq_status::timedout;
         }
 
         lfrbq_status status = try_enqueue(value);
@@ -322,12 +768,15 @@ private:
         }
     }   
 
-    lfrbq_status dequeue_sem(uintptr_t *value)
+    lfrbq_status dequeue_sem(uintptr_t *value, const rbq_clock::time_point* deadline)
     {
         if (!full_nodes.try_acquire())
         {
-            tls_lfrbq_stats.consumer_waits++;
-            full_nodes.acquire();
+            this->count_stat(&lfrbq_stats_t::consumer_waits);
+            if (deadline == nullptr)
+                full_nodes.acquire();
+            else if (!full_nodes.try_acquire_until(*deadline))
+                return lfrbq_status::timedout;
         }
         
         lfrbq_status status = try_dequeue(value);
@@ -348,74 +797,975 @@ private:
     }
 
 
-
-public:
+    /**
+     * @brief move spin budget toward sample
+     *
+     * A wait resolved while spinning samples twice the spins it took, one
+     * resolved while yielding samples the max since more spinning would have
+     * done, and one that had to park samples the min since spinning was wasted.
+     */
+    static void adapt_spin(std::atomic<uint32_t>& spin_budget, uint32_t budget, uint32_t sample)
+    {
+        sample = std::clamp(sample, adaptive_spin_min, adaptive_spin_max);
+        int32_t delta = ((int32_t) sample - (int32_t) budget) / 8;
+        if (delta != 0)
+            spin_budget.store(budget + delta, std::memory_order_relaxed);
+    }
 
     /**
-     * @brief enqueue a value, blocks if queue is full
-     * @param value to be queued
-     * @retval lfrbq_status::success enqueue succeeded
-     * @retval lfrbq_status::closed  enqueue failed - queue closed
+     * @brief adaptive wait, spin w/ pause, then yield, then park on eventcount
+     * @param spin_budget the side's spin budget
+     * @param eventcount posted by the other side
+     * @param retry status to keep waiting on, full or empty
+     * @param deadline absolute time, or nullptr to wait forever
+     * @param attempt retries the enqueue or dequeue
+     * @return status of the attempt that wasn't retry, or timedout
+     *
+     * The deadline is checked before parking, the spin and yield phases are bounded.
      */
-    lfrbq_status enqueue(uintptr_t value)
+    template<typename F>
+    lfrbq_status wait_adaptive(std::atomic<uint32_t>& spin_budget, event_count& eventcount, lfrbq_status retry, const rbq_clock::time_point* deadline, F&& attempt)
     {
-        switch (sync)
+        uint32_t budget = spin_budget.load(std::memory_order_relaxed);
+        lfrbq_status status;
+
+        for (uint32_t n = 1; n <= budget; n++)
+        {
+            cpu_relax();
+            if ((status = attempt()) != retry)
+            {
+                adapt_spin(spin_budget, budget, 2 * n);
+                this->count_stat(&lfrbq_stats_t::spin_resolved);
+                return status;
+            }
+        }
+
+        for (unsigned int n = 0; n < adaptive_yields; n++)
+        {
+            std::this_thread::yield();
+            if ((status = attempt()) != retry)
+            {
+                adapt_spin(spin_budget, budget, adaptive_spin_max);
+                this->count_stat(&lfrbq_stats_t::yield_resolved);
+                return status;
+            }
+        }
+
+        adapt_spin(spin_budget, budget, adaptive_spin_min);
+        for (;;)
         {
-            case rbq_sync::mutex: return enqueue_mx(value);
-            case rbq_sync::eventcount: return enqueue_ec(value);
-            case rbq_sync::yield: return enqueue_x(value);
-            case rbq_sync::semaphore: return enqueue_sem(value);
-            case rbq_sync::atomic32: return enqueue_a32(value);
+            if (expired(deadline))
+                return lfrbq_status::timedout;
 
-            default: return lfrbq_status::fail;
+            uint32_t mark = eventcount.mark();
+            if ((status = attempt()) != retry)
+            {
+                eventcount.reset(mark);
+                break;
+            }
+            wait_ec(eventcount, mark, deadline);
+            if ((status = attempt()) != retry)
+                break;
         }
+        this->count_stat(&lfrbq_stats_t::park_resolved);
+        return status;
     }
 
-    /**
-     * @brief dequeue a value, blocks if queue is empty and not closed
-     * @param value address for returned value
-     * @retval lfrbq_status::success dequeue succeeded
-     * @retval lfrbq_status::closed  dequeue failed - queue is empty and closed
-     */
-    lfrbq_status dequeue(uintptr_t *value)
+    lfrbq_status enqueue_ad(uintptr_t value, const rbq_clock::time_point* deadline)
     {
-        switch (sync)
+        lfrbq_status status = try_enqueue(value);
+        if (status == lfrbq_status::full)
         {
-            case rbq_sync::mutex: return dequeue_mx(value);
-            case rbq_sync::eventcount: return dequeue_ec(value);
-            case rbq_sync::yield: return dequeue_x(value);
-            case rbq_sync::semaphore: return dequeue_sem(value);
-            case rbq_sync::atomic32: return dequeue_a32(value);
+            this->count_stat(&lfrbq_stats_t::producer_waits);
+            status = wait_adaptive(producer_spin, consumer_eventcount, lfrbq_status::full, deadline, [&] { return try_enqueue(value); });
+        }
+        if (status == lfrbq_status::success)
+            producer_eventcount.post();
+        return status;
+    }
 
-            default: return lfrbq_status::fail;
+    lfrbq_status dequeue_ad(uintptr_t *value, const rbq_clock::time_point* deadline)
+    {
+        lfrbq_status status = try_dequeue(value);
+        if (status == lfrbq_status::empty)
+        {
+            this->count_stat(&lfrbq_stats_t::consumer_waits);
+            status = wait_adaptive(consumer_spin, producer_eventcount, lfrbq_status::empty, deadline, [&] { return try_dequeue(value); });
         }
+        if (status == lfrbq_status::success)
+            consumer_eventcount.post();
+        return status;
     }
 
-    /**
-     * @brief close the queue
-     */
-    void close()
+    lfrbq_status enqueue_rd(uintptr_t value, const rbq_clock::time_point* deadline)
     {
-        lfrbq::close();
+        bool armed = false;
+        for (;;)
+        {
+            lfrbq_status status = try_enqueue(value);
+            switch (status)
+            {
+                case lfrbq_status::success:
+                    readable.signal();
+                    return status;
+                case lfrbq_status::closed:
+                    return status;
+
+                case lfrbq_status::full:
+                default:
+                    break;
+            }
+
+            if (!armed)
+            {
+                writable.arm();
+                armed = true;
+                continue;
+            }
+            if (expired(deadline))
+                return lfrbq_status::timedout;
+            this->count_stat(&lfrbq_stats_t::producer_waits);
+            writable.wait(deadline);
+            armed = false;
+        }
+    }
+
+    lfrbq_status dequeue_rd(uintptr_t *value, const rbq_clock::time_point* deadline)
+    {
+        bool armed = false;
+        for (;;)
+        {
+            lfrbq_status status = try_dequeue(value);
+            switch (status)
+            {
+                case lfrbq_status::success:
+                    writable.signal();
+                    return status;
+                case lfrbq_status::closed:
+                    return status;
+
+                case lfrbq_status::empty:
+                default:
+                    break;
+            }
+
+            if (!armed)
+            {
+                readable.arm();
+                armed = true;
+                continue;
+            }
+            if (expired(deadline))
+                return lfrbq_status::timedout;
+            this->count_stat(&lfrbq_stats_t::consumer_waits);
+            readable.wait(deadline);
+            armed = false;
+        }
+    }
+
+
+    /**
+     * @brief resume a coroutine w/ the executor, or inline if none
+     */
+    void resume(std::coroutine_handle<> handle)
+    {
+        if (resume_fn != nullptr)
+            resume_fn(resume_arg, handle);
+        else
+            handle.resume();
+    }
+
+    /**
+     * @brief complete the enqueues and dequeues of async waiters after a queue update or close
+     *
+     * Suspended waiters get their enqueue or dequeue done for them, in FIFO
+     * order, until neither list makes progress, and are then resumed w/ its
+     * status outside the lock.  Waiters register and retry under the lock
+     * before suspending, so either the update is seen by the retry or the
+     * waiter is seen here.
+     */
+    void wake_async()
+    {
+        if constexpr (uses(rbq_sync::async))
+        {
+            if (sync != rbq_sync::async || !have_waiters(async_waiters))
+                return;
+
+            async_list resumed;
+            uint32_t enqueued = 0;
+            uint32_t dequeued = 0;
+            {
+                std::lock_guard lk(async_mutex);
+                for (bool progress = true; progress;)
+                {
+                    progress = false;
+                    while (!async_consumers.empty())
+                    {
+                        async_waiter* waiter = async_consumers.head;
+                        if ((waiter->status = try_dequeue(waiter->out)) == lfrbq_status::empty)
+                            break;
+                        if (waiter->status == lfrbq_status::success)
+                        {
+                            dequeued++;
+                            progress = true;
+                        }
+                        resumed.push_back(async_consumers.pop_front());
+                        async_waiters.fetch_sub(1, std::memory_order_relaxed);
+                    }
+                    while (!async_producers.empty())
+                    {
+                        async_waiter* waiter = async_producers.head;
+                        if ((waiter->status = try_enqueue(waiter->value)) == lfrbq_status::full)
+                            break;
+                        if (waiter->status == lfrbq_status::success)
+                        {
+                            enqueued++;
+                            progress = true;
+                        }
+                        resumed.push_back(async_producers.pop_front());
+                        async_waiters.fetch_sub(1, std::memory_order_relaxed);
+                    }
+                }
+            }
+
+            if (dequeued > 0)
+                post(consumer_eventcount, dequeued);
+            if (enqueued > 0)
+            {
+                post(producer_eventcount, enqueued);
+                post_waitset();
+            }
+            if (enqueued > 0 || dequeued > 0)
+                check_watermarks();
+
+            while (!resumed.empty())
+                resume(resumed.pop_front()->handle);
+        }
+    }
+
+    /**
+     * @brief register async waiter and retry, suspend if still full or empty
+     * @param list async_producers or async_consumers
+     * @return true to suspend, false if the retry completed
+     */
+    bool suspend_async(async_waiter& waiter, async_list& list)
+    {
+        bool producer = &list == &async_producers;
+        async_waiters.fetch_add(1, std::memory_order_seq_cst);
+        {
+            std::lock_guard lk(async_mutex);
+            waiter.status = producer ? try_enqueue(waiter.value) : try_dequeue(waiter.out);
+            if (waiter.status == (producer ? lfrbq_status::full : lfrbq_status::empty))
+            {
+                this->count_stat(producer ? &lfrbq_stats_t::producer_waits : &lfrbq_stats_t::consumer_waits);
+                list.push_back(&waiter);
+                return true;
+            }
+            async_waiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+        if (waiter.status == lfrbq_status::success)
+            async_done(producer);
+        return false;
+    }
+
+    /**
+     * @brief wakeups after an async enqueue or dequeue done by the caller
+     */
+    void async_done(bool enqueued)
+    {
+        if (enqueued)
+        {
+            post(producer_eventcount);
+            post_waitset();
+        }
+        else
+            post(consumer_eventcount);
+        wake_async();
+        check_watermarks();
+    }
+
+    lfrbq_status enqueue_as(uintptr_t value, const rbq_clock::time_point* deadline)
+    {
+        lfrbq_status status = enqueue_ec(value, deadline);
+        if (status == lfrbq_status::success)
+            wake_async();
+        return status;
+    }
+
+    lfrbq_status dequeue_as(uintptr_t *value, const rbq_clock::time_point* deadline)
+    {
+        lfrbq_status status = dequeue_ec(value, deadline);
+        if (status == lfrbq_status::success)
+            wake_async();
+        return status;
+    }
+
+
+    /**
+     * @brief non-blocking bulk enqueue w/ wakeup of waiting consumers
+     * @return number of values enqueued
+     */
+    uint32_t enqueue_bulk_x(const uintptr_t* values, uint32_t count)
+    {
+        uint32_t n;
+
+        if constexpr (uses(rbq_sync::eventcount))
+            if (posts_eventcounts())
+            {
+                n = try_enqueue_bulk(values, count);
+                if (n > 0)
+                {
+                    post(producer_eventcount, n);
+                    wake_async();
+                }
+                return n;
+            }
+
+        if constexpr (uses(rbq_sync::mutex))
+            if (sync == rbq_sync::mutex)
+            {
+                {
+                    std::unique_lock lk(producer_mutex);
+                    n = try_enqueue_bulk(values, count);
+                }
+                if (n > 0)
+                    notify_mx(consumer_mutex, consumer_cvar, consumer_waiters);
+                return n;
+            }
+
+        if constexpr (uses(rbq_sync::atomic32))
+            if (sync == rbq_sync::atomic32)
+            {
+                n = try_enqueue_bulk(values, count);
+                if (n > 0)
+                    notify_a32(producer_atomic32, consumer_waiters, true);
+                return n;
+            }
+
+        if constexpr (uses(rbq_sync::semaphore))
+            if (sync == rbq_sync::semaphore)
+            {
+                uint32_t acquired = empty_nodes.try_acquire_many(count);
+                if (acquired == 0)
+                    return 0;
+
+                n = try_enqueue_bulk(values, acquired);
+                if (n < acquired)
+                    empty_nodes.release(acquired - n);     // closed
+                if (n > 0)
+                    full_nodes.release(n);
+                return n;
+            }
+
+        if constexpr (uses(rbq_sync::readiness))
+            if (sync == rbq_sync::readiness)
+            {
+                n = try_enqueue_bulk(values, count);
+                if (n > 0)
+                    readable.signal();
+                return n;
+            }
+
+        return try_enqueue_bulk(values, count);     // yield
+    }
+
+    /**
+     * @brief non-blocking bulk dequeue w/ wakeup of waiting producers
+     * @return number of values dequeued
+     */
+    uint32_t dequeue_bulk_x(uintptr_t* values, uint32_t count)
+    {
+        uint32_t n;
+
+        if constexpr (uses(rbq_sync::eventcount))
+            if (posts_eventcounts())
+            {
+                n = try_dequeue_bulk(values, count);
+                if (n > 0)
+                {
+                    post(consumer_eventcount, n);
+                    wake_async();
+                }
+                return n;
+            }
+
+        if constexpr (uses(rbq_sync::mutex))
+            if (sync == rbq_sync::mutex)
+            {
+                {
+                    std::unique_lock lk(consumer_mutex);
+                    n = try_dequeue_bulk(values, count);
+                }
+                if (n > 0)
+                    notify_mx(producer_mutex, producer_cvar, producer_waiters);
+                return n;
+            }
+
+        if constexpr (uses(rbq_sync::atomic32))
+            if (sync == rbq_sync::atomic32)
+            {
+                n = try_dequeue_bulk(values, count);
+                if (n > 0)
+                    notify_a32(consumer_atomic32, producer_waiters, true);
+                return n;
+            }
+
+        if constexpr (uses(rbq_sync::semaphore))
+            if (sync == rbq_sync::semaphore)
+            {
+                uint32_t acquired = full_nodes.try_acquire_many(count);
+                if (acquired == 0)
+                    return 0;
+
+                n = try_dequeue_bulk(values, acquired);
+                if (n < acquired)
+                    full_nodes.release(acquired - n);      // closed
+                if (n > 0)
+                    empty_nodes.release(n);
+                return n;
+            }
+
+        if constexpr (uses(rbq_sync::readiness))
+            if (sync == rbq_sync::readiness)
+            {
+                n = try_dequeue_bulk(values, count);
+                if (n > 0)
+                    writable.signal();
+                return n;
+            }
+
+        return try_dequeue_bulk(values, count);     // yield
+    }
+
+
+    /**
+     * @brief enqueue a value w/ the sync type's wait loop
+     * @param deadline absolute time, or nullptr to wait forever
+     */
+    lfrbq_status enqueue_wait(uintptr_t value, const rbq_clock::time_point* deadline)
+    {
+        if constexpr (uses(rbq_sync::mutex))
+            if (sync == rbq_sync::mutex) return enqueue_mx(value, deadline);
+        if constexpr (uses(rbq_sync::eventcount))
+            if (sync == rbq_sync::eventcount || sync == rbq_sync::handoff) return enqueue_ec(value, deadline);
+        if constexpr (uses(rbq_sync::yield))
+            if (sync == rbq_sync::yield) return enqueue_x(value, deadline);
+        if constexpr (uses(rbq_sync::semaphore))
+            if (sync == rbq_sync::semaphore) return enqueue_sem(value, deadline);
+        if constexpr (uses(rbq_sync::atomic32))
+            if (sync == rbq_sync::atomic32) return enqueue_a32(value, deadline);
+        if constexpr (uses(rbq_sync::adaptive))
+            if (sync == rbq_sync::adaptive) return enqueue_ad(value, deadline);
+        if constexpr (uses(rbq_sync::readiness))
+            if (sync == rbq_sync::readiness) return enqueue_rd(value, deadline);
+        if constexpr (uses(rbq_sync::async))
+            if (sync == rbq_sync::async) return enqueue_as(value, deadline);
+
+        return lfrbq_status::fail;
+    }
+
+    /**
+     * @brief dequeue a value w/ the sync type's wait loop
+     * @param deadline absolute time, or nullptr to wait forever
+     */
+    lfrbq_status dequeue_wait(uintptr_t *value, const rbq_clock::time_point* deadline)
+    {
+        if constexpr (uses(rbq_sync::mutex))
+            if (sync == rbq_sync::mutex) return dequeue_mx(value, deadline);
+        if constexpr (uses(rbq_sync::eventcount))
+            if (sync == rbq_sync::eventcount || sync == rbq_sync::handoff) return dequeue_ec(value, deadline);
+        if constexpr (uses(rbq_sync::yield))
+            if (sync == rbq_sync::yield) return dequeue_x(value, deadline);
+        if constexpr (uses(rbq_sync::semaphore))
+            if (sync == rbq_sync::semaphore) return dequeue_sem(value, deadline);
+        if constexpr (uses(rbq_sync::atomic32))
+            if (sync == rbq_sync::atomic32) return dequeue_a32(value, deadline);
+        if constexpr (uses(rbq_sync::adaptive))
+            if (sync == rbq_sync::adaptive) return dequeue_ad(value, deadline);
+        if constexpr (uses(rbq_sync::readiness))
+            if (sync == rbq_sync::readiness) return dequeue_rd(value, deadline);
+        if constexpr (uses(rbq_sync::async))
+            if (sync == rbq_sync::async) return dequeue_as(value, deadline);
+
+        return lfrbq_status::fail;
+    }
+
+
+public:
+
+    /**
+     * @brief enqueue a value, blocks if queue is full
+     * @param value to be queued
+     * @retval lfrbq_status::success enqueue succeeded
+     * @retval lfrbq_status::closed  enqueue failed - queue closed
+     */
+    lfrbq_status enqueue(uintptr_t value)
+    {
+        lfrbq_status status = enqueue_wait(value, nullptr);
+        if (status == lfrbq_status::success)
+        {
+            post_waitset();
+            check_watermarks();
+        }
+        return status;
+    }
+
+    /**
+     * @brief enqueue a value, blocks until deadline if queue is full
+     * @param value to be queued
+     * @param deadline absolute rbq_clock (CLOCK_MONOTONIC) time
+     * @retval lfrbq_status::success  enqueue succeeded
+     * @retval lfrbq_status::closed   enqueue failed - queue closed
+     * @retval lfrbq_status::timedout enqueue failed - queue still full at deadline
+     */
+    lfrbq_status enqueue_until(uintptr_t value, rbq_clock::time_point deadline)
+    {
+        lfrbq_status status = enqueue_wait(value, &deadline);
+        if (status == lfrbq_status::success)
+        {
+            post_waitset();
+            check_watermarks();
+        }
+        return status;
+    }
+
+    /**
+     * @brief enqueue a value, blocks for up to timeout if queue is full
+     * @see enqueue_until()
+     */
+    template<typename Rep, typename Period>
+    lfrbq_status enqueue_for(uintptr_t value, std::chrono::duration<Rep, Period> timeout)
+    {
+        return enqueue_until(value, rbq_clock::now() + std::chrono::ceil<rbq_clock::duration>(timeout));
+    }
+
+    /**
+     * @brief dequeue a value, blocks if queue is empty and not closed
+     * @param value address for returned value
+     * @retval lfrbq_status::success dequeue succeeded
+     * @retval lfrbq_status::closed  dequeue failed - queue is empty and closed
+     */
+    lfrbq_status dequeue(uintptr_t *value)
+    {
+        lfrbq_status status = dequeue_wait(value, nullptr);
+        if (status == lfrbq_status::success)
+            check_watermarks();
+        return status;
+    }
+
+    /**
+     * @brief dequeue a value, blocks until deadline if queue is empty and not closed
+     * @param value address for returned value
+     * @param deadline absolute rbq_clock (CLOCK_MONOTONIC) time
+     * @retval lfrbq_status::success  dequeue succeeded
+     * @retval lfrbq_status::closed   dequeue failed - queue is empty and closed
+     * @retval lfrbq_status::timedout dequeue failed - queue still empty at deadline
+     */
+    lfrbq_status dequeue_until(uintptr_t *value, rbq_clock::time_point deadline)
+    {
+        lfrbq_status status = dequeue_wait(value, &deadline);
+        if (status == lfrbq_status::success)
+            check_watermarks();
+        return status;
+    }
+
+    /**
+     * @brief dequeue a value, blocks for up to timeout if queue is empty and not closed
+     * @see dequeue_until()
+     */
+    template<typename Rep, typename Period>
+    lfrbq_status dequeue_for(uintptr_t *value, std::chrono::duration<Rep, Period> timeout)
+    {
+        return dequeue_until(value, rbq_clock::now() + std::chrono::ceil<rbq_clock::duration>(timeout));
+    }
+
+    /**
+     * @brief enqueue multiple values, blocks if queue is full
+     * @param values to be queued
+     * @param count number of values
+     * @return number of values enqueued, less than count only if queue closed
+     */
+    uint32_t enqueue_bulk(const uintptr_t* values, uint32_t count)
+    {
+        uint32_t n = 0;
+        while (n < count)
+        {
+            uint32_t k = enqueue_bulk_x(values + n, count - n);
+            if (k > 0)
+                post_waitset();
+            else
+            {
+                if (enqueue(values[n]) != lfrbq_status::success)
+                    break;
+                k = 1;
+            }
+            n += k;
+        }
+        if (n > 0)
+            check_watermarks();
+        return n;
+    }
+
+    /**
+     * @brief dequeue multiple values, blocks if queue is empty and not closed
+     * @param values address for returned values
+     * @param count max number of values
+     * @return number of values dequeued, 0 only if queue is empty and closed
+     */
+    uint32_t dequeue_bulk(uintptr_t* values, uint32_t count)
+    {
+        if (count == 0)
+            return 0;
+
+        uint32_t n = dequeue_bulk_x(values, count);
+        if (n == 0)
+        {
+            if (dequeue(&values[0]) != lfrbq_status::success)
+                return 0;
+            n = 1 + dequeue_bulk_x(values + 1, count - 1);
+        }
+        check_watermarks();
+        return n;
+    }
+
+    /**
+     * @brief dequeue a batch of values, blocks until min are dequeued and then for up to timeout for more
+     * @param values address for returned values
+     * @param min number of values to block for, 0 to return right away if the queue is empty
+     * @param max max number of values
+     * @param timeout how long to keep gathering values after min are dequeued
+     * @return number of values dequeued, less than min only if queue is empty and closed
+     * @throws invalid_argument if min greater than max
+     *
+     * Values are dequeued in bulk as they're available, and the wait for more
+     * uses the sync type's timed wait, so a consumer writing to a disk or socket
+     * wakes once per batch at high rates and a value waits at most timeout
+     * after the first min at low rates.  The timeout only starts once a value
+     * has been dequeued.
+     */
+    template<typename Rep, typename Period>
+    uint32_t dequeue_batch(uintptr_t* values, uint32_t min, uint32_t max, std::chrono::duration<Rep, Period> timeout)
+    {
+        if (min > max)
+            throw std::invalid_argument("batch min greater than max");
+
+        uint32_t n = min == 0 ? dequeue_bulk_x(values, max) : 0;
+        while (n < min)
+        {
+            uint32_t k = dequeue_bulk_x(values + n, max - n);
+            if (k == 0)
+            {
+                if (dequeue_wait(&values[n], nullptr) != lfrbq_status::success)
+                    break;
+                k = 1;
+            }
+            n += k;
+        }
+
+        if (n >= min && n > 0)
+        {
+            rbq_clock::time_point deadline = rbq_clock::now() + std::chrono::ceil<rbq_clock::duration>(timeout);
+            while (n < max)
+            {
+                uint32_t k = dequeue_bulk_x(values + n, max - n);
+                if (k == 0)
+                {
+                    if (dequeue_wait(&values[n], &deadline) != lfrbq_status::success)
+                        break;
+                    k = 1;
+                }
+                n += k;
+            }
+        }
+
+        if (n > 0)
+            check_watermarks();
+        return n;
+    }
+
+    /**
+     * @brief set high and low watermarks
+     * @param high size at which the queue is over the high watermark, 0 to remove the watermarks
+     * @param low size at which the queue is back under the low watermark, less than high
+     * @param fn callback on crossing a watermark, or nullptr to only poll above_watermark()
+     * @param arg callback argument
+     * @throws invalid_argument if high greater than capacity or low not less than high
+     *
+     * Enqueue calls back when the size reaches high, and dequeue calls back
+     * when the size falls to low after that, so upstream stages can throttle
+     * before the queue is full and producers start to wait.  Callbacks run on
+     * the enqueueing or dequeueing thread and should be short.  The size is
+     * approximate, see lfrbq::size(), and w/ watermarks set every enqueue and
+     * dequeue loads the head and tail.
+     *
+     * Set the watermarks before the queue is used.  A shmq doesn't have
+     * watermarks, the callback would be called in every attached process.
+     */
+    void set_watermarks(uint32_t high, uint32_t low, rbq_watermark_fn fn = nullptr, void* arg = nullptr)
+    {
+        if (high > this->capacity || (high != 0 && low >= high))
+            throw std::invalid_argument("watermarks not 0 <= low < high <= capacity");
+
+        high_watermark = high;
+        low_watermark = low;
+        watermark_fn = fn;
+        watermark_arg = arg;
+        watermark_high.store(false, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief queue is in process shared memory, i.e. a shmq
+     */
+    bool process_shared() const { return shared; }
+
+    /**
+     * @brief queue reached the high watermark and hasn't fallen to the low watermark since
+     */
+    bool above_watermark() { return watermark_high.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief eventfd readable when the queue may have become non-empty or closed, readiness sync
+     *
+     * The fd is only written after dequeue_ready() or dequeue_bulk_ready()
+     * found the queue empty, or a blocking dequeue waited, so a consumer
+     * polling it dequeues until empty before polling again.  It stays readable
+     * once the queue is closed.
+     */
+    int dequeue_fd() requires (rbq_sync_uses(stype, rbq_sync::readiness)) { return readable.get(); }
+
+    /**
+     * @brief eventfd readable when the queue may have become non-full or closed, readiness sync
+     * @see dequeue_fd()
+     */
+    int enqueue_fd() requires (rbq_sync_uses(stype, rbq_sync::readiness)) { return writable.get(); }
+
+    /**
+     * @brief enqueue a value w/o blocking, arm enqueue_fd() if queue is full, readiness sync
+     * @retval lfrbq_status::success enqueue succeeded
+     * @retval lfrbq_status::full    enqueue failed - queue full, enqueue_fd() armed
+     * @retval lfrbq_status::closed  enqueue failed - queue closed
+     */
+    lfrbq_status enqueue_ready(uintptr_t value) requires (rbq_sync_uses(stype, rbq_sync::readiness))
+    {
+        lfrbq_status status = try_enqueue(value);
+        if (status == lfrbq_status::full)
+        {
+            writable.arm();
+            status = try_enqueue(value);
+        }
+        if (status == lfrbq_status::success)
+        {
+            readable.signal();
+            post_waitset();
+            check_watermarks();
+        }
+        return status;
+    }
+
+    /**
+     * @brief dequeue a value w/o blocking, arm dequeue_fd() if queue is empty, readiness sync
+     * @retval lfrbq_status::success dequeue succeeded
+     * @retval lfrbq_status::empty   dequeue failed - queue empty, dequeue_fd() armed
+     * @retval lfrbq_status::closed  dequeue failed - queue is empty and closed
+     */
+    lfrbq_status dequeue_ready(uintptr_t *value) requires (rbq_sync_uses(stype, rbq_sync::readiness))
+    {
+        lfrbq_status status = try_dequeue(value);
+        if (status == lfrbq_status::empty)
+        {
+            readable.arm();
+            status = try_dequeue(value);
+        }
+        if (status == lfrbq_status::success)
+        {
+            writable.signal();
+            check_watermarks();
+        }
+        return status;
+    }
+
+    /**
+     * @brief dequeue up to count values w/o blocking, arm dequeue_fd() if queue is empty, readiness sync
+     * @return number of values dequeued, 0 if the queue is empty or closed
+     *
+     * Drains the queue in batches when dequeue_fd() fires, call until it returns 0.
+     */
+    uint32_t dequeue_bulk_ready(uintptr_t* values, uint32_t count) requires (rbq_sync_uses(stype, rbq_sync::readiness))
+    {
+        if (count == 0)
+            return 0;
+
+        uint32_t n = try_dequeue_bulk(values, count);
+        if (n == 0)
+        {
+            readable.arm();
+            n = try_dequeue_bulk(values, count);
+        }
+        if (n > 0)
+        {
+            writable.signal();
+            check_watermarks();
+        }
+        return n;
+    }
+
+    /**
+     * @brief awaiter for async_enqueue()
+     */
+    class enqueue_awaiter : async_waiter
+    {
+        rbq* queue;
+
+        friend class rbq;
+
+        enqueue_awaiter(rbq* queue, uintptr_t value) : queue(queue) { this->value = value; }
+
+    public:
+
+        bool await_ready()
+        {
+            if ((this->status = queue->try_enqueue(this->value)) == lfrbq_status::full)
+                return false;
+            if (this->status == lfrbq_status::success)
+                queue->async_done(true);
+            return true;
+        }
+
+        bool await_suspend(std::coroutine_handle<> handle)
+        {
+            this->handle = handle;
+            return queue->suspend_async(*this, queue->async_producers);
+        }
+
+        lfrbq_status await_resume() { return this->status; }
+    };
+
+    /**
+     * @brief awaiter for async_dequeue()
+     */
+    class dequeue_awaiter : async_waiter
+    {
+        rbq* queue;
+
+        friend class rbq;
+
+        dequeue_awaiter(rbq* queue, uintptr_t* value) : queue(queue) { this->out = value; }
+
+    public:
+
+        bool await_ready()
+        {
+            if ((this->status = queue->try_dequeue(this->out)) == lfrbq_status::empty)
+                return false;
+            if (this->status == lfrbq_status::success)
+                queue->async_done(false);
+            return true;
+        }
+
+        bool await_suspend(std::coroutine_handle<> handle)
+        {
+            this->handle = handle;
+            return queue->suspend_async(*this, queue->async_consumers);
+        }
+
+        lfrbq_status await_resume() { return this->status; }
+    };
+
+    /**
+     * @brief enqueue a value, suspends the calling coroutine if queue is full, async sync
+     * @param value to be queued
+     * @return awaiter, co_await returns
+     * lfrbq_status::success or lfrbq_status::closed - enqueue failed, queue closed
+     *
+     * A suspended coroutine has its enqueue done by the dequeue that frees
+     * a slot, and is resumed w/ the executor, see set_executor().
+     */
+    enqueue_awaiter async_enqueue(uintptr_t value) requires (rbq_sync_uses(stype, rbq_sync::async))
+    {
+        if (sync != rbq_sync::async)
+            throw std::invalid_argument("queue sync type not async");
+        return enqueue_awaiter(this, value);
+    }
+
+    /**
+     * @brief dequeue a value, suspends the calling coroutine if queue is empty and not closed, async sync
+     * @param value address for returned value, must stay valid until resumed
+     * @return awaiter, co_await returns
+     * lfrbq_status::success or lfrbq_status::closed - dequeue failed, queue is empty and closed
+     *
+     * A suspended coroutine has its dequeue done by the enqueue that fills
+     * the queue, and is resumed w/ the executor, see set_executor().
+     */
+    dequeue_awaiter async_dequeue(uintptr_t *value) requires (rbq_sync_uses(stype, rbq_sync::async))
+    {
+        if (sync != rbq_sync::async)
+            throw std::invalid_argument("queue sync type not async");
+        return dequeue_awaiter(this, value);
+    }
+
+    /**
+     * @brief set executor for resuming suspended coroutines, async sync
+     * @param fn called w/ the coroutine handle, or nullptr to resume it inline
+     * @param arg executor argument
+     *
+     * W/o an executor coroutines are resumed inline on the enqueueing,
+     * dequeueing, or closing thread, after its own enqueue or dequeue is
+     * done.  Set the executor before the queue is used.
+     */
+    void set_executor(rbq_resume_fn fn, void* arg = nullptr) requires (rbq_sync_uses(stype, rbq_sync::async))
+    {
+        resume_fn = fn;
+        resume_arg = arg;
+    }
+
+    /**
+     * @brief close the queue
+     *
+     * Suspended async_enqueue() coroutines are resumed w/ lfrbq_status::closed,
+     * as are suspended async_dequeue() coroutines once the queue is drained.
+     */
+    void close()
+    {
+        base::close();
 
         /*
         * close queue before closing or posting the eventcounts
         * and notifying the cvars.
         */
 
-        producer_eventcount.close();
-        consumer_eventcount.close();
+        if constexpr (uses(rbq_sync::eventcount))
+        {
+            producer_eventcount.close();
+            consumer_eventcount.close();
+        }
 
-        producer_cvar.notify_all();
-        consumer_cvar.notify_all();
+        if constexpr (uses(rbq_sync::mutex))
+        {
+            notify_mx(producer_mutex, producer_cvar, producer_waiters);
+            notify_mx(consumer_mutex, consumer_cvar, consumer_waiters);
+        }
+
+        if constexpr (uses(rbq_sync::atomic32))
+        {
+            notify_a32(producer_atomic32, consumer_waiters, true);
+            notify_a32(consumer_atomic32, producer_waiters, true);
+        }
 
-        producer_atomic32.fetch_add(1, std::memory_order_relaxed);
-        producer_atomic32.notify_all();
-        consumer_atomic32.fetch_add(1, std::memory_order_relaxed);
-        consumer_atomic32.notify_all();
+        if constexpr (uses(rbq_sync::semaphore))
+        {
+            empty_nodes.release();
+            full_nodes.release();
+        }
+
+        if constexpr (uses(rbq_sync::readiness))
+            if (sync == rbq_sync::readiness)
+            {
+                readable.latch();
+                writable.latch();
+            }
 
-        empty_nodes.release();
-        full_nodes.release();
+        wake_async();
+        post_waitset();
     }
 
 };
@@ -0,0 +1,224 @@
+/*
+   Copyright 2025 Joseph W. Seigh
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include <errno.h>
+#include <stdint.h>
+#include <linux/futex.h>
+
+#include <rbq.h>
+#include <eventcount.h>
+
+
+/**
+ * @brief wait for any of a set of queues to be non-empty or closed
+ * @tparam Q queue type, an rbq or shmq
+ *
+ * Queues that post their eventcounts, eventcount, adaptive, handoff, and
+ * async sync, are waited on directly w/ futex_waitv() on each queue's
+ * producer eventcount, up to the futex_waitv() limit.  The other queues, or
+ * all of them if the kernel doesn't have futex_waitv(), post a waitset
+ * eventcount after their enqueues, and that eventcount is waited on as well.
+ * A queue posting the waitset eventcount costs a load of the eventcount per
+ * enqueue when nobody is waiting.
+ * Handoff queues waited on directly post values to all waiters, so the
+ * waitset thread doesn't take a wakeup meant for a blocked dequeue.
+ *
+ * Readiness is per size() and closed() so it's a hint, a dequeue from a
+ * ready queue may still find it empty, e.g. w/ mpmc_faa producers that
+ * have claimed a node but not stored the value yet.
+ *
+ * Queues are added before waiting and not removed, and the waitset has to
+ * outlive enqueues to its queues.  One thread waits at a time.  Process
+ * shared queues can only be waited on directly, they can't post a waitset
+ * eventcount in another process.
+ */
+template<typename Q>
+class rbq_waitset
+{
+    static constexpr unsigned int max_direct = FUTEX_WAITV_MAX - 1;     // one entry for the waitset eventcount
+
+    static constexpr bool has_eventcounts = std::is_same_v<decltype(Q::producer_eventcount), event_count>;
+
+    std::vector<Q*> queues;
+    std::vector<Q*> direct;             // waited on w/ futex_waitv()
+    std::vector<uint32_t> marks;        // direct queue eventcount marks
+    std::vector<struct futex_waitv> waitv;
+    unsigned int nposting = 0;          // queues posting eventcount
+
+    const bool use_waitv;
+
+    event_count eventcount;             // posted by queues not waited on directly
+
+    /**
+     * @brief get ready queue indexes
+     * @return number of ready queues
+     */
+    size_t scan(std::vector<size_t>& ready)
+    {
+        ready.clear();
+        for (size_t ndx = 0; ndx < queues.size(); ndx++)
+            if (queues[ndx]->size() > 0 || queues[ndx]->closed())
+                ready.push_back(ndx);
+        return ready.size();
+    }
+
+    /**
+     * @brief wait
+     * @param deadline absolute time, or nullptr to wait forever
+     * @return number of ready queues, 0 if deadline passed
+     */
+    size_t wait(std::vector<size_t>& ready, const rbq_clock::time_point* deadline)
+    {
+        for (;;)
+        {
+            if (scan(ready) > 0)
+                return ready.size();
+
+            uint32_t mark = nposting > 0 ? eventcount.mark() : 0;
+            if constexpr (has_eventcounts)
+                for (size_t ndx = 0; ndx < direct.size(); ndx++)
+                    marks[ndx] = direct[ndx]->producer_eventcount.mark();
+
+            if (scan(ready) == 0 && !(deadline != nullptr && rbq_clock::now() >= *deadline))
+            {
+                if (direct.empty())
+                {
+                    if (deadline == nullptr)
+                        eventcount.wait(mark);
+                    else
+                        eventcount.waituntil(mark, *deadline);
+                }
+                else if constexpr (has_eventcounts)
+                {
+                    waitv.clear();
+                    for (size_t ndx = 0; ndx < direct.size(); ndx++)
+                        waitv.push_back(direct[ndx]->producer_eventcount.waitv(marks[ndx]));
+                    if (nposting > 0)
+                        waitv.push_back(eventcount.waitv(mark));
+
+                    struct timespec timeout;
+                    if (deadline != nullptr)
+                        timeout = monotonic_timespec(*deadline);
+                    futex_waitv(waitv.data(), waitv.size(), deadline != nullptr ? &timeout : nullptr);
+                }
+            }
+
+            if (nposting > 0)
+                eventcount.reset(mark);
+            if constexpr (has_eventcounts)
+                for (size_t ndx = 0; ndx < direct.size(); ndx++)
+                    direct[ndx]->producer_eventcount.reset(marks[ndx]);
+
+            if (ready.size() > 0)
+                return ready.size();
+            if (deadline != nullptr && rbq_clock::now() >= *deadline)
+                return scan(ready);
+        }
+    }
+
+public:
+
+    /**
+     * @brief create a waitset
+     * @param use_waitv wait on queue eventcounts directly if the kernel has
+     * futex_waitv(), false to have all queues post the waitset eventcount
+     */
+    explicit rbq_waitset(bool use_waitv = true) : use_waitv(use_waitv && futex_waitv_supported()) {}
+
+    ~rbq_waitset()
+    {
+        for (Q* queue : queues)
+        {
+            queue->waitset_eventcount.store(nullptr, std::memory_order_relaxed);
+            queue->waitset_direct.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    rbq_waitset(const rbq_waitset&) = delete;
+    rbq_waitset& operator =(const rbq_waitset&) = delete;
+
+    /**
+     * @brief add a queue
+     * @return the queue's index in ready lists
+     * @throws invalid_argument if queue already in a waitset, or it's process shared and can't be waited on directly
+     */
+    size_t add(Q& queue)
+    {
+        if (queue.waitset_eventcount.load(std::memory_order_relaxed) != nullptr || queue.waitset_direct.load(std::memory_order_relaxed))
+            throw std::invalid_argument("queue already in a waitset");
+
+        if (has_eventcounts && use_waitv && queue.posts_eventcounts() && direct.size() < max_direct)
+        {
+            direct.push_back(&queue);
+            marks.push_back(0);
+            queue.waitset_direct.store(true, std::memory_order_release);
+        }
+        else
+        {
+            if (queue.process_shared())
+                throw std::invalid_argument("process shared queue can't be waited on w/o futex_waitv");
+            queue.waitset_eventcount.store(&eventcount, std::memory_order_release);
+            nposting++;
+        }
+
+        queues.push_back(&queue);
+        return queues.size() - 1;
+    }
+
+    /**
+     * @brief number of queues
+     */
+    size_t size() { return queues.size(); }
+
+    /**
+     * @brief queue at index
+     */
+    Q& queue(size_t ndx) { return *queues[ndx]; }
+
+    /**
+     * @brief wait for any queue to be non-empty or closed
+     * @param ready returned indexes of ready queues
+     * @return number of ready queues
+     */
+    size_t wait(std::vector<size_t>& ready) { return wait(ready, nullptr); }
+
+    /**
+     * @brief wait until deadline for any queue to be non-empty or closed
+     * @param ready returned indexes of ready queues
+     * @param deadline absolute rbq_clock (CLOCK_MONOTONIC) time
+     * @return number of ready queues, 0 if deadline passed
+     */
+    size_t wait_until(std::vector<size_t>& ready, rbq_clock::time_point deadline) { return wait(ready, &deadline); }
+
+    /**
+     * @brief wait for up to timeout for any queue to be non-empty or closed
+     * @see wait_until()
+     */
+    template<typename Rep, typename Period>
+    size_t wait_for(std::vector<size_t>& ready, std::chrono::duration<Rep, Period> timeout)
+    {
+        return wait_until(ready, rbq_clock::now() + std::chrono::ceil<rbq_clock::duration>(timeout));
+    }
+};
+
+/*==*/
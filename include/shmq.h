@@ -0,0 +1,255 @@
+/*
+   Copyright 2025 Joseph W. Seigh
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <rbq.h>
+
+
+/**
+ * @brief shared queue segment header, at offset 0 of the segment
+ */
+struct shmq_header
+{
+    static constexpr uint64_t shmq_magic = 0x71626c66'716d6873;   // "shmqflbq"
+    static constexpr uint32_t shmq_version = 1;
+
+    uint64_t magic;
+    uint32_t version;
+    uint32_t capacity;
+    int32_t qtype;
+    int32_t stype;
+    uint32_t node_size;
+    uint32_t queue_size;            // sizeof queue object
+    uint64_t map_size;              // segment size
+    std::atomic<uint32_t> ready;    // queue constructed
+};
+
+
+/**
+ * @brief lock-free blocking queue in a shared memory segment
+ * @tparam qtype queue type, one of mpmc, mpsc, spmc, spsc, or mpmc_faa
+ * @tparam stype synchronization type, eventcount, yield, adaptive, or handoff
+ * @tparam node_t ring buffer node type, see lfrbq
+ *
+ * The segment holds a header, the queue, and its ring buffer.  The ring
+ * buffer is located by its offset from the queue and the eventcounts use
+ * process shared futexes, so the segment can be mapped at any address in
+ * any process and all of them use the same lock-free enqueue and dequeue.
+ * The queue, sync, and node types have to match in all processes.
+ *
+ * Segments are POSIX shared memory objects attached by name, or any file
+ * descriptor for a sized shared file, e.g. a memfd passed to another process.
+ *
+ * The sp and sc restrictions are per queue, not per process.  Mutex,
+ * semaphore, and atomic32 sync aren't process shared and aren't supported,
+ * and neither are watermarks.
+ *
+ * Statistics counters are per process, see lfrbq_stats_registry.  The queue
+ * is never destroyed, so its counters aren't unregistered, and each process
+ * that counts anything for it keeps them until it exits.  Compile w/
+ * LFRBQ_STATS=0 if that matters.
+ */
+template<lfrbq_type qtype = mpmc, rbq_sync stype = rbq_sync::eventcount, typename node_t = lfrbq_node>
+class shmq : public rbq<qtype, stype, node_t>
+{
+    static_assert(qtype != runtime_qtype, "queue type must be fixed at compile time");
+    static_assert(stype == rbq_sync::eventcount || stype == rbq_sync::yield || stype == rbq_sync::adaptive || stype == rbq_sync::handoff,
+        "sync type must be eventcount, yield, adaptive, or handoff");
+
+    using base = rbq<qtype, stype, node_t>;
+
+    static constexpr size_t queue_offset = (sizeof(shmq_header) + 63) & ~(size_t) 63;
+    static constexpr size_t nodes_offset = queue_offset + ((sizeof(base) + 63) & ~(size_t) 63);
+
+    shmq(uint32_t capacity, lfrbq_layout layout, node_t* nodes) : base(capacity, layout, nodes, true) {}
+
+    static shmq_header* header(shmq* queue) { return (shmq_header*) ((char*) queue - queue_offset); }
+
+    static void* map(int fd, size_t size)
+    {
+        void* addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED)
+            throw std::system_error(errno, std::generic_category(), "mmap");
+        return addr;
+    }
+
+public:
+
+    /**
+     * @brief create queue in a shared file
+     * @param fd descriptor of an empty shared file, e.g. from memfd_create, sized by create
+     * @param capacity of queue, must be power of 2 and >= 2
+     * @param layout ring buffer node layout
+     * @return queue, mapped in this process until detach()
+     * @throws invalid_argument if capacity not power of 2 or capacity is too small
+     * @throws system_error if file can't be sized or mapped
+     */
+    static shmq* create(int fd, uint32_t capacity, lfrbq_layout layout = linear_layout)
+    {
+        size_t map_size = nodes_offset + (size_t) capacity * sizeof(node_t);
+        if (ftruncate(fd, map_size) != 0)
+            throw std::system_error(errno, std::generic_category(), "ftruncate");
+
+        char* addr = (char*) map(fd, map_size);
+
+        shmq_header* hdr = new (addr) shmq_header{shmq_header::shmq_magic, shmq_header::shmq_version, capacity,
+            qtype, stype, sizeof(node_t), sizeof(shmq), map_size, 0};
+
+        shmq* queue;
+        try {
+            queue = new (addr + queue_offset) shmq(capacity, layout, (node_t*) (addr + nodes_offset));
+        }
+        catch (...) {
+            munmap(addr, map_size);
+            throw;
+        }
+
+        hdr->ready.store(1, std::memory_order_release);
+        return queue;
+    }
+
+    /**
+     * @brief create queue in a new POSIX shared memory object
+     * @param name shared memory object name, "/name"
+     * @see create(int,uint32_t,lfrbq_layout)
+     * @throws system_error if object already exists
+     */
+    static shmq* create(const char* name, uint32_t capacity, lfrbq_layout layout = linear_layout)
+    {
+        int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd < 0)
+            throw std::system_error(errno, std::generic_category(), "shm_open");
+
+        try {
+            shmq* queue = create(fd, capacity, layout);
+            ::close(fd);
+            return queue;
+        }
+        catch (...) {
+            ::close(fd);
+            shm_unlink(name);
+            throw;
+        }
+    }
+
+    /**
+     * @brief attach to queue in a shared file
+     * @param fd descriptor of shared file the queue was created in
+     * @return queue, mapped in this process until detach()
+     * @throws invalid_argument if not a queue of this type
+     * @throws system_error if file can't be mapped or queue isn't ready in 1 second
+     */
+    static shmq* attach(int fd)
+    {
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+            throw std::system_error(errno, std::generic_category(), "fstat");
+        if ((size_t) st.st_size < nodes_offset)
+            throw std::invalid_argument("not a shared queue");
+
+        char* addr = (char*) map(fd, st.st_size);
+        shmq_header* hdr = (shmq_header*) addr;
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+        while (hdr->ready.load(std::memory_order_acquire) == 0)
+        {
+            if (std::chrono::steady_clock::now() > deadline)
+            {
+                munmap(addr, st.st_size);
+                throw std::system_error(ETIMEDOUT, std::generic_category(), "shared queue not ready");
+            }
+            std::this_thread::yield();
+        }
+
+        if (hdr->magic != shmq_header::shmq_magic || hdr->version != shmq_header::shmq_version || hdr->map_size != (uint64_t) st.st_size)
+        {
+            munmap(addr, st.st_size);
+            throw std::invalid_argument("not a shared queue");
+        }
+
+        if (hdr->qtype != qtype || hdr->stype != stype || hdr->node_size != sizeof(node_t) || hdr->queue_size != sizeof(shmq))
+        {
+            munmap(addr, st.st_size);
+            throw std::invalid_argument("shared queue type mismatch");
+        }
+
+        return (shmq*) (addr + queue_offset);
+    }
+
+    /**
+     * @brief attach to queue in a POSIX shared memory object
+     * @param name shared memory object name the queue was created w/
+     * @see attach(int)
+     */
+    static shmq* attach(const char* name)
+    {
+        int fd = shm_open(name, O_RDWR, 0);
+        if (fd < 0)
+            throw std::system_error(errno, std::generic_category(), "shm_open");
+
+        try {
+            shmq* queue = attach(fd);
+            ::close(fd);
+            return queue;
+        }
+        catch (...) {
+            ::close(fd);
+            throw;
+        }
+    }
+
+    /**
+     * @brief unmap queue from this process
+     *
+     * The queue is never destroyed, it goes away w/ the segment when it's
+     * unlinked and the last process detaches.
+     */
+    static void detach(shmq* queue)
+    {
+        shmq_header* hdr = header(queue);
+        munmap(hdr, hdr->map_size);
+    }
+
+    /**
+     * @brief remove POSIX shared memory object name
+     */
+    static int unlink(const char* name) { return shm_unlink(name); }
+
+    shmq(const shmq&) = delete;
+    shmq& operator =(const shmq&) = delete;
+
+    /**
+     * @brief not supported, the watermarks and callback pointer would be in the shared segment
+     */
+    void set_watermarks(uint32_t high, uint32_t low, rbq_watermark_fn fn = nullptr, void* arg = nullptr) = delete;
+};
+
+/*==*/
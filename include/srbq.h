@@ -0,0 +1,415 @@
+/*
+   Copyright 2025 Joseph W. Seigh
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <new>
+#include <stdexcept>
+
+#include <stdint.h>
+#include <sched.h>
+
+#include <lfrbq.h>
+#include <eventcount.h>
+
+
+/**
+ * @brief srbq shard selection
+ */
+enum srbq_shard
+{
+    shard_by_thread = 0,    // threads assigned to shards round robin on first use
+    shard_by_cpu = 1,       // current cpu, sched_getcpu()
+};
+
+
+/**
+ * @brief sharded lock-free blocking queue
+ * @tparam qtype shard queue type, mpmc, mpmc_faa, or runtime_qtype (the default) to set it w/ the ctor
+ * @tparam node_t shard ring buffer node type, see lfrbq
+ *
+ * The queue is split into nshards lfrbq shards so threads on different cores
+ * mostly update different heads and tails.  Enqueue goes to the thread's local
+ * shard, or any other shard if that one is full.  Dequeue takes from the local
+ * shard first and then steals from the others, starting at a random shard.
+ * FIFO order is only per shard.  A producer w/ shard_by_thread always uses the
+ * same shard, so its values stay in order unless its shard fills.
+ *
+ * Blocking is the same as rbq w/ eventcount sync, one pair of eventcounts for
+ * all the shards.  Shards are multi-producer, multi-consumer since any thread
+ * can spill or steal to any shard.
+ */
+template<lfrbq_type qtype = runtime_qtype, typename node_t = lfrbq_node>
+class srbq
+{
+    static_assert(qtype == runtime_qtype || qtype == mpmc || qtype == mpmc_faa, "shard queue type must be mpmc or mpmc_faa");
+
+    using shard_t = lfrbq<qtype, node_t>;
+
+    alignas(64) event_count producer_eventcount;        // posted by producers, consumers wait
+    alignas(64) event_count consumer_eventcount;        // posted by consumers, producers wait
+
+    const unsigned int nshards;
+    const srbq_shard shard_mode;
+    shard_t* shards;
+
+    [[no_unique_address]] lfrbq_stats stats_counter;    // shared by all shards
+
+    inline static std::atomic<unsigned int> thread_count = 0;
+    inline static thread_local unsigned int thread_ndx = thread_count.fetch_add(1, std::memory_order_relaxed);
+    inline static thread_local uint32_t steal_seed = 0;
+
+    template<typename... Args>
+    void init(Args&&... args)
+    {
+        if (nshards == 0)
+            throw std::invalid_argument("shard count is 0");
+
+        shards = (shard_t*) ::operator new[](nshards * sizeof(shard_t), std::align_val_t(alignof(shard_t)));
+        unsigned int ndx = 0;
+        try {
+            for (; ndx < nshards; ndx++)
+            {
+                new (&shards[ndx]) shard_t(args...);
+                shards[ndx].share_stats(stats_counter);
+            }
+        }
+        catch (...) {
+            while (ndx > 0)
+                shards[--ndx].~shard_t();
+            ::operator delete[](shards, std::align_val_t(alignof(shard_t)));
+            throw;
+        }
+    }
+
+    unsigned int local_shard()
+    {
+        if (shard_mode == shard_by_cpu)
+        {
+            int cpu = sched_getcpu();
+            return cpu < 0 ? thread_ndx % nshards : (unsigned int) cpu % nshards;
+        }
+        return thread_ndx % nshards;
+    }
+
+    /**
+     * @brief first shard to steal from, xorshift random
+     */
+    unsigned int steal_start()
+    {
+        uint32_t x = steal_seed;
+        if (x == 0)
+            x = (thread_ndx + 1) * 0x9e3779b9;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        steal_seed = x;
+        return x % nshards;
+    }
+
+    /**
+     * @brief closed and all shards drained
+     */
+    bool drained()
+    {
+        if (!closed())
+            return false;
+        for (unsigned int ndx = 0; ndx < nshards; ndx++)
+            if (!shards[ndx].drained())
+                return false;
+        return true;
+    }
+
+public:
+
+    /**
+     * @brief create sharded lock-free blocking queue
+     * @param count number of shards
+     * @param capacity of each shard, must be power of 2 and >= 2
+     * @param type shard queue type, mpmc or mpmc_faa
+     * @param layout shard ring buffer node layout
+     * @param alloc shard ring buffer allocation options
+     * @param mode local shard selection
+     * @throws invalid_argument if count is 0, type isn't mpmc or mpmc_faa, or capacity not power of 2 or less than 2
+     */
+    srbq(unsigned int count, uint32_t capacity, lfrbq_type type, lfrbq_layout layout = linear_layout, const lfrbq_alloc_options& alloc = {}, srbq_shard mode = shard_by_thread) requires (qtype == runtime_qtype) :
+        nshards(count), shard_mode(mode)
+    {
+        if (type != mpmc && type != mpmc_faa)
+            throw std::invalid_argument("shard queue type must be mpmc or mpmc_faa");
+        init(capacity, type, layout, alloc);
+    }
+
+    /**
+     * @brief create sharded lock-free blocking queue w/ shards of type qtype
+     * @see srbq(unsigned int,uint32_t,lfrbq_type,lfrbq_layout,const lfrbq_alloc_options&,srbq_shard)
+     */
+    srbq(unsigned int count, uint32_t capacity, lfrbq_layout layout = linear_layout, const lfrbq_alloc_options& alloc = {}, srbq_shard mode = shard_by_thread) requires (qtype != runtime_qtype) :
+        nshards(count), shard_mode(mode)
+    {
+        init(capacity, layout, alloc);
+    }
+
+    ~srbq()
+    {
+        for (unsigned int ndx = 0; ndx < nshards; ndx++)
+            shards[ndx].~shard_t();
+        ::operator delete[](shards, std::align_val_t(alignof(shard_t)));
+    }
+
+    srbq(const srbq&) = delete;
+    srbq& operator =(const srbq&) = delete;
+
+    /**
+     * @brief number of shards
+     */
+    unsigned int shard_count() { return nshards; }
+
+    /**
+     * @brief close the queue, all shards
+     */
+    void close()
+    {
+        for (unsigned int ndx = 0; ndx < nshards; ndx++)
+            shards[ndx].close();
+
+        producer_eventcount.close();
+        consumer_eventcount.close();
+    }
+
+    /**
+     * @brief get queue closed status
+     */
+    bool closed() { return shards[0].closed(); }
+
+    /**
+     * @brief approximate number of values, summed over all shards, see lfrbq::size()
+     */
+    uint32_t size()
+    {
+        uint32_t n = 0;
+        for (unsigned int ndx = 0; ndx < nshards; ndx++)
+            n += shards[ndx].size();
+        return n;
+    }
+
+    /**
+     * @brief queue statistics, summed over all threads and shards
+     */
+    lfrbq_stats_t stats() const
+    {
+        return stats_counter.snapshot();
+    }
+
+    /**
+     * @brief enqueue a value on the local shard, or another shard if it's full
+     * @param value to be queued
+     * @retval lfrbq_status::success enqueue succeeded
+     * @retval lfrbq_status::full    enqueue failed - all shards full
+     * @retval lfrbq_status::closed  enqueue failed - queue closed
+     */
+    lfrbq_status try_enqueue(uintptr_t value)
+    {
+        unsigned int home = local_shard();
+        for (unsigned int n = 0; n < nshards; n++)
+        {
+            unsigned int ndx = home + n < nshards ? home + n : home + n - nshards;
+            lfrbq_status status = shards[ndx].try_enqueue(value);
+            if (status != lfrbq_status::full)
+                return status;
+        }
+        return lfrbq_status::full;
+    }
+
+    /**
+     * @brief dequeue a value from the local shard, or steal one from another shard
+     * @param value address for returned value
+     * @retval lfrbq_status::success dequeue succeeded
+     * @retval lfrbq_status::empty   dequeue failed - all shards empty
+     * @retval lfrbq_status::closed  dequeue failed - queue is empty and closed
+     */
+    lfrbq_status try_dequeue(uintptr_t* value)
+    {
+        unsigned int home = local_shard();
+        if (shards[home].try_dequeue(value) == lfrbq_status::success)
+            return lfrbq_status::success;
+
+        unsigned int start = steal_start();
+        for (unsigned int n = 0; n < nshards; n++)
+        {
+            unsigned int ndx = start + n < nshards ? start + n : start + n - nshards;
+            if (ndx == home)
+                continue;
+            if (shards[ndx].try_dequeue(value) == lfrbq_status::success)
+            {
+                stats_counter.count(&lfrbq_stats_t::consumer_steals);
+                return lfrbq_status::success;
+            }
+        }
+
+        return drained() ? lfrbq_status::closed : lfrbq_status::empty;
+    }
+
+    /**
+     * @brief enqueue multiple values, local shard first
+     * @return number of values enqueued, less than count if all shards full or queue closed
+     */
+    uint32_t try_enqueue_bulk(const uintptr_t* values, uint32_t count)
+    {
+        unsigned int home = local_shard();
+        uint32_t k = 0;
+        for (unsigned int n = 0; n < nshards && k < count; n++)
+        {
+            unsigned int ndx = home + n < nshards ? home + n : home + n - nshards;
+            k += shards[ndx].try_enqueue_bulk(values + k, count - k);
+        }
+        return k;
+    }
+
+    /**
+     * @brief dequeue multiple values, local shard first then stealing
+     * @return number of values dequeued, 0 if queue empty or closed
+     */
+    uint32_t try_dequeue_bulk(uintptr_t* values, uint32_t count)
+    {
+        unsigned int home = local_shard();
+        uint32_t k = shards[home].try_dequeue_bulk(values, count);
+        if (k > 0)
+            return k;
+
+        unsigned int start = steal_start();
+        for (unsigned int n = 0; n < nshards; n++)
+        {
+            unsigned int ndx = start + n < nshards ? start + n : start + n - nshards;
+            if (ndx == home)
+                continue;
+            k = shards[ndx].try_dequeue_bulk(values, count);
+            if (k > 0)
+            {
+                stats_counter.count(&lfrbq_stats_t::consumer_steals);
+                return k;
+            }
+        }
+        return 0;
+    }
+
+    /**
+     * @brief enqueue a value, blocks if all shards are full
+     * @see rbq::enqueue
+     */
+    lfrbq_status enqueue(uintptr_t value)
+    {
+        for (;;)
+        {
+            lfrbq_status status = try_enqueue(value);
+            if (status != lfrbq_status::full)
+            {
+                if (status == lfrbq_status::success)
+                    producer_eventcount.post();
+                return status;
+            }
+
+            uint32_t mark = consumer_eventcount.mark();
+            status = try_enqueue(value);
+            if (status != lfrbq_status::full)
+            {
+                consumer_eventcount.reset(mark);
+                if (status == lfrbq_status::success)
+                    producer_eventcount.post();
+                return status;
+            }
+            stats_counter.count(&lfrbq_stats_t::producer_waits);
+            consumer_eventcount.wait(mark);
+        }
+    }
+
+    /**
+     * @brief dequeue a value, blocks if all shards are empty and queue not closed
+     * @see rbq::dequeue
+     */
+    lfrbq_status dequeue(uintptr_t* value)
+    {
+        for (;;)
+        {
+            lfrbq_status status = try_dequeue(value);
+            if (status != lfrbq_status::empty)
+            {
+                if (status == lfrbq_status::success)
+                    consumer_eventcount.post();
+                return status;
+            }
+
+            uint32_t mark = producer_eventcount.mark();
+            status = try_dequeue(value);
+            if (status != lfrbq_status::empty)
+            {
+                producer_eventcount.reset(mark);
+                if (status == lfrbq_status::success)
+                    consumer_eventcount.post();
+                return status;
+            }
+            stats_counter.count(&lfrbq_stats_t::consumer_waits);
+            producer_eventcount.wait(mark);
+        }
+    }
+
+    /**
+     * @brief enqueue multiple values, blocks if all shards are full
+     * @see rbq::enqueue_bulk
+     */
+    uint32_t enqueue_bulk(const uintptr_t* values, uint32_t count)
+    {
+        uint32_t n = 0;
+        while (n < count)
+        {
+            uint32_t k = try_enqueue_bulk(values + n, count - n);
+            if (k == 0)
+            {
+                if (enqueue(values[n]) != lfrbq_status::success)
+                    break;
+                k = 1;
+            }
+            else
+                producer_eventcount.post();
+            n += k;
+        }
+        return n;
+    }
+
+    /**
+     * @brief dequeue multiple values, blocks if all shards are empty and queue not closed
+     * @see rbq::dequeue_bulk
+     */
+    uint32_t dequeue_bulk(uintptr_t* values, uint32_t count)
+    {
+        if (count == 0)
+            return 0;
+
+        uint32_t n = try_dequeue_bulk(values, count);
+        if (n == 0)
+        {
+            if (dequeue(&values[0]) != lfrbq_status::success)
+                return 0;
+            n = 1 + try_dequeue_bulk(values + 1, count - 1);
+        }
+        consumer_eventcount.post();
+        return n;
+    }
+
+};
+
+/*==*/
@@ -0,0 +1,324 @@
+/*
+   Copyright 2025 Joseph W. Seigh
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <type_traits>
+#include <utility>
+#include <new>
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <lfrbq.h>
+
+/**
+ * @brief typed values can be carried directly in lfrbq_node value
+ */
+template<typename T>
+constexpr bool tlfrbq_inplace = std::is_trivially_copyable_v<T> && (sizeof(T) <= sizeof(uintptr_t));
+
+/**
+ * @brief typed lock-free bounded queue
+ *
+ * Values are move constructed into slot storage owned by the queue and
+ * moved out on dequeue.  Slot indices are passed through two lfrbq's, a free
+ * slot queue and the queue proper, so the sequence and close protocol are
+ * the same as lfrbq.  Slot indices fit in 32 bits so both use compact
+ * nodes.  Values still queued when the queue is destroyed are destroyed
+ * with it.
+ *
+ * @tparam T value type, must be move constructible and move assignable
+ * @tparam qtype queue type, see lfrbq
+ */
+template<typename T, lfrbq_type qtype = runtime_qtype, bool inplace = tlfrbq_inplace<T>>
+class tlfrbq
+{
+    struct alignas(T) slot_t
+    {
+        unsigned char data[sizeof(T)];
+    };
+
+    /**
+     * @brief free slot queue type
+     * producers of the queue are the consumers of the free slot queue.
+     * Slots are released by the queue's consumers after a dequeue and by
+     * its producers when an enqueue fails, so the free slot queue is always
+     * multi-producer.
+     */
+    static constexpr lfrbq_type free_type(lfrbq_type type)
+    {
+        return type == runtime_qtype ? runtime_qtype : (lfrbq_type) ((type & 4) | ((type & 2) >> 1));
+    }
+
+    lfrbq<qtype, lfrbq_compact_node> queue;                     // slot indices of queued values
+    lfrbq<free_type(qtype), lfrbq_compact_node> free_slots;     // slot indices of available slots
+
+    slot_t* slots;
+
+    T* slot(uintptr_t ndx) { return std::launder(reinterpret_cast<T*>(slots[ndx].data)); }
+
+    /**
+     * @brief get free slot
+     * @retval lfrbq_status::success slot reserved
+     * @retval lfrbq_status::full    no free slots
+     * @retval lfrbq_status::closed  queue closed
+     */
+    lfrbq_status reserve(uintptr_t* ndx)
+    {
+        if (free_slots.try_dequeue(ndx) == lfrbq_status::success)
+            return lfrbq_status::success;
+        else if (queue.closed())
+            return lfrbq_status::closed;
+        else
+            return lfrbq_status::full;
+    }
+
+    void release(uintptr_t ndx)
+    {
+        if (free_slots.try_enqueue(ndx) != lfrbq_status::success)
+            abort();                    // free slots are never more than capacity and never closed
+    }
+
+    void init(uint32_t capacity)
+    {
+        size_t alignment = alignof(slot_t) < 16 ? 16 : alignof(slot_t);
+        size_t sz = capacity * sizeof(slot_t);
+        sz = (sz + alignment - 1) & ~(alignment - 1);
+        slots = (slot_t*) aligned_alloc(alignment, sz);
+        if (slots == nullptr)
+            throw std::bad_alloc();
+
+        for (uintptr_t ndx = 0; ndx < capacity; ndx++)
+            free_slots.try_enqueue(ndx);
+    }
+
+public:
+
+    /**
+     * @brief create typed lock-free bounded queue
+     * @param capacity of queue, must be power of 2 and >= 2
+     * @param type queue type, one of mpmc, mpsc, spmc, spsc, or mpmc_faa
+     * @throws invalid_argument if size not power of 2 or size is less than 2
+     */
+    tlfrbq(uint32_t capacity, lfrbq_type type) requires (qtype == runtime_qtype) :
+        queue(capacity, type),
+        free_slots(capacity, free_type(type))
+    {
+        init(capacity);
+    }
+
+    /**
+     * @brief create typed lock-free bounded queue of type qtype
+     * @param capacity of queue, must be power of 2 and >= 2
+     * @throws invalid_argument if size not power of 2 or size is less than 2
+     */
+    explicit tlfrbq(uint32_t capacity) requires (qtype != runtime_qtype) :
+        queue(capacity),
+        free_slots(capacity)
+    {
+        init(capacity);
+    }
+
+    ~tlfrbq()
+    {
+        uintptr_t ndx;
+        while (queue.try_dequeue(&ndx) == lfrbq_status::success)
+        {
+            slot(ndx)->~T();
+        }
+        free(slots);
+    }
+
+    tlfrbq(const tlfrbq&) = delete;
+    tlfrbq& operator =(const tlfrbq&) = delete;
+
+    /**
+     * @brief close the queue
+     */
+    void close() { queue.close(); }
+
+    /**
+     * @brief get queue closed status
+     */
+    bool closed() { return queue.closed(); }
+
+    /**
+     * @brief approximate number of values in the queue, see lfrbq::size()
+     */
+    uint32_t size() { return queue.size(); }
+
+    /**
+     * @brief queue statistics, full counts are free slot queue empty counts
+     */
+    lfrbq_stats_t stats() const
+    {
+        lfrbq_stats_t sum = queue.stats();
+        sum.queue_full_count += free_slots.stats().queue_empty_count;
+        return sum;
+    }
+
+    /**
+     * @brief construct a value in place and enqueue it
+     * @param args T constructor arguments
+     * @retval lfrbq_status::success enqueue succeeded
+     * @retval lfrbq_status::full    enqueue failed - queue full
+     * @retval lfrbq_status::closed  enqueue failed - queue closed
+     */
+    template<typename... Args>
+    lfrbq_status try_emplace(Args&&... args)
+    {
+        uintptr_t ndx;
+        lfrbq_status status = reserve(&ndx);
+        if (status != lfrbq_status::success)
+            return status;
+
+        T* item;
+        try {
+            item = new (slots[ndx].data) T(std::forward<Args>(args)...);
+        }
+        catch (...) {
+            release(ndx);
+            throw;
+        }
+
+        status = queue.try_enqueue(ndx);
+        if (status != lfrbq_status::success)
+        {
+            item->~T();
+            release(ndx);
+        }
+        return status;
+    }
+
+    /**
+     * @brief enqueue a value
+     * @param value to be queued, only moved from if enqueue succeeded
+     * @retval lfrbq_status::success enqueue succeeded
+     * @retval lfrbq_status::full    enqueue failed - queue full
+     * @retval lfrbq_status::closed  enqueue failed - queue closed
+     */
+    lfrbq_status try_enqueue(T&& value)
+    {
+        uintptr_t ndx;
+        lfrbq_status status = reserve(&ndx);
+        if (status != lfrbq_status::success)
+            return status;
+
+        T* item = new (slots[ndx].data) T(std::move(value));
+
+        status = queue.try_enqueue(ndx);
+        if (status != lfrbq_status::success)
+        {
+            value = std::move(*item);
+            item->~T();
+            release(ndx);
+        }
+        return status;
+    }
+
+    /**
+     * @brief enqueue a copy of a value
+     * @see try_emplace
+     */
+    lfrbq_status try_enqueue(const T& value) { return try_emplace(value); }
+
+    /**
+     * @brief dequeue a value
+     * @param value address for returned value, value is move assigned
+     * @retval lfrbq_status::success dequeue succeeded
+     * @retval lfrbq_status::empty    dequeue failed - queue empty
+     * @retval lfrbq_status::closed  dequeue failed - queue is empty and closed
+     */
+    lfrbq_status try_dequeue(T* value)
+    {
+        uintptr_t ndx;
+        lfrbq_status status = queue.try_dequeue(&ndx);
+        if (status != lfrbq_status::success)
+            return status;
+
+        T* item = slot(ndx);
+        *value = std::move(*item);
+        item->~T();
+        release(ndx);
+
+        return status;
+    }
+
+};
+
+
+/**
+ * @brief typed lock-free bounded queue for small trivially copyable types
+ *
+ * Values are carried directly in the lfrbq node value, a compact node
+ * if they fit in 32 bits.
+ */
+template<typename T, lfrbq_type qtype>
+class tlfrbq<T, qtype, true>
+{
+    using node_t = std::conditional_t<(sizeof(T) <= sizeof(uint32_t)), lfrbq_compact_node, lfrbq_node>;
+
+    lfrbq<qtype, node_t> queue;
+
+    static uintptr_t to_value(const T& value)
+    {
+        uintptr_t x = 0;
+        memcpy(&x, &value, sizeof(T));
+        return x;
+    }
+
+public:
+
+    /**
+     * @see tlfrbq::tlfrbq(uint32_t,lfrbq_type)
+     */
+    tlfrbq(uint32_t capacity, lfrbq_type type) requires (qtype == runtime_qtype) : queue(capacity, type) {}
+
+    /**
+     * @see tlfrbq::tlfrbq(uint32_t)
+     */
+    explicit tlfrbq(uint32_t capacity) requires (qtype != runtime_qtype) : queue(capacity) {}
+
+    tlfrbq(const tlfrbq&) = delete;
+    tlfrbq& operator =(const tlfrbq&) = delete;
+
+    void close() { queue.close(); }
+
+    bool closed() { return queue.closed(); }
+
+    uint32_t size() { return queue.size(); }
+
+    lfrbq_stats_t stats() const { return queue.stats(); }
+
+    template<typename... Args>
+    lfrbq_status try_emplace(Args&&... args) { return try_enqueue(T(std::forward<Args>(args)...)); }
+
+    lfrbq_status try_enqueue(const T& value) { return queue.try_enqueue(to_value(value)); }
+
+    lfrbq_status try_dequeue(T* value)
+    {
+        uintptr_t x;
+        lfrbq_status status = queue.try_dequeue(&x);
+        if (status == lfrbq_status::success)
+            memcpy(value, &x, sizeof(T));
+        return status;
+    }
+
+};
+
+/*==*/
@@ -0,0 +1,576 @@
+/*
+   Copyright 2025 Joseph W. Seigh
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include <thread>
+
+#include <stdint.h>
+
+#include <lfrbq.h>
+
+
+/**
+ * @brief ulfrbq resize policy
+ *
+ * Occupancy is ulfrbq::size() over the current capacity.  The capacity is
+ * doubled if it stays at or above high_water for dwell, and halved if it stays
+ * at or below low_water for dwell, w/in min_capacity and max_capacity.
+ */
+struct ulfrbq_resize_policy
+{
+    double high_water = 0.9;                // grow at or above
+    double low_water = 0.1;                 // shrink at or below
+    std::chrono::nanoseconds dwell = std::chrono::seconds(10);     // time occupancy must stay past water mark
+    uint32_t min_capacity = 64;
+    uint32_t max_capacity = 1u << 20;
+};
+
+
+/**
+ * @brief unbounded lock-free queue of lfrbq segments
+ * @tparam qtype segment queue type, one of mpmc, mpsc, spmc, spsc, or mpmc_faa
+ * @tparam node_t segment ring buffer node type, see lfrbq
+ *
+ * Segments are fixed capacity lfrbq's linked in a list, as in LCRQ.  When
+ * the tail segment is full, the producer closes it and appends a new segment
+ * w/ its value already in it.  When a consumer finds the head segment closed
+ * and drained it moves the head to the next segment.
+ *
+ * Segments removed from the list are retired and reset for reuse once no
+ * thread holds a hazard pointer to them.  Up to cache_size reset segments are
+ * kept so steady state enqueue and dequeue don't allocate.
+ *
+ * Segment allocation and retirement take a mutex.  That's once per segment
+ * capacity values.  Enqueue and dequeue are otherwise lock-free.
+ *
+ * A bounded queue doesn't append segments when the tail segment is full and
+ * try_enqueue returns full instead.  It can be resized while in use.  resize()
+ * closes the tail segment and appends an empty segment of the new capacity.
+ * Producers continue w/ the new segment right away and consumers move to it
+ * when they've drained the old one, so neither side waits for the resize.
+ * Until then the queue can hold the old segment's values plus the new capacity.
+ *
+ * For sp queue types, the close in resize() has the same restriction as
+ * lfrbq::close(), it has to be called from the producer thread.
+ */
+template<lfrbq_type qtype = mpmc, typename node_t = lfrbq_node>
+class ulfrbq
+{
+    static_assert(qtype != runtime_qtype, "segment queue type must be fixed at compile time");
+
+    struct segment : public lfrbq<qtype, node_t>
+    {
+        std::atomic<segment*> next = nullptr;
+
+        segment(uint32_t capacity, lfrbq_layout layout, const lfrbq_stats& stats) : lfrbq<qtype, node_t>(capacity, layout)
+        {
+            this->stats_counter.share(stats);
+        }
+
+        using lfrbq<qtype, node_t>::reset;
+        using lfrbq<qtype, node_t>::capacity;
+
+        /**
+         * @brief approximate number of values in segment
+         */
+        uint32_t count()
+        {
+            seq_t head_copy = this->head.load(std::memory_order_acquire);
+            seq_t tail_copy = this->tail.load(std::memory_order_acquire) & ~Q_TAIL_CLOSED;
+            int64_t n = (int64_t) (tail_copy + capacity - head_copy);
+            return n < 0 ? 0 : n > capacity ? capacity : (uint32_t) n;
+        }
+    };
+
+    /**
+     * next link of the tail segment after the queue is closed
+     */
+    static inline segment* const closed_link = reinterpret_cast<segment*>(uintptr_t(1));
+
+    /**
+     * @brief hazard pointer, claimed for the duration of an enqueue or dequeue
+     */
+    struct alignas(64) hazard_t
+    {
+        std::atomic<bool> in_use = false;
+        std::atomic<segment*> ptr = nullptr;
+    };
+
+    static constexpr unsigned int max_hazards = 128;   // max concurrent enqueues and dequeues
+
+    inline static thread_local unsigned int hazard_hint = 0;
+
+
+    alignas(64) std::atomic<segment*> head_segment;
+    alignas(64) std::atomic<segment*> tail_segment;
+
+    alignas(64) std::atomic<bool> qclosed = false;
+
+    std::atomic<uint32_t> capacity;         // capacity of new segments
+    const lfrbq_layout layout;
+    const unsigned int cache_size;          // max reset segments kept for reuse
+    const bool bounded;                     // don't append segments when full
+
+    ulfrbq_resize_policy policy;            // see poll_resize()
+    std::chrono::steady_clock::time_point water_mark_time;  // time occupancy went past water mark
+    int water_mark = 0;                     // 1 above high water, -1 below low water, 0 neither
+
+    std::mutex cache_mutex;                 // protects cache and retired
+    std::vector<segment*> cache;            // reset segments
+    std::vector<segment*> retired;          // segments that may still be referenced
+
+    hazard_t hazards[max_hazards];
+
+    [[no_unique_address]] lfrbq_stats stats_counter;    // shared by all segments
+
+
+    hazard_t* acquire_hazard()
+    {
+        unsigned int ndx = hazard_hint;
+        for (;;)
+        {
+            for (unsigned int n = 0; n < max_hazards; n++, ndx = (ndx + 1) % max_hazards)
+            {
+                bool expected = false;
+                if (!hazards[ndx].in_use.load(std::memory_order_relaxed)
+                    && hazards[ndx].in_use.compare_exchange_strong(expected, true, std::memory_order_acquire))
+                {
+                    hazard_hint = ndx;
+                    return &hazards[ndx];
+                }
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    void release_hazard(hazard_t* hazard)
+    {
+        hazard->ptr.store(nullptr, std::memory_order_release);
+        hazard->in_use.store(false, std::memory_order_release);
+    }
+
+    /**
+     * @brief load segment pointer and set hazard pointer to it
+     */
+    segment* protect(std::atomic<segment*>& src, hazard_t* hazard)
+    {
+        segment* seg = src.load(std::memory_order_acquire);
+        for (;;)
+        {
+            hazard->ptr.store(seg, std::memory_order_seq_cst);
+            segment* seg2 = src.load(std::memory_order_seq_cst);
+            if (seg2 == seg)
+                return seg;
+            seg = seg2;
+        }
+    }
+
+    bool hazardous(segment* seg)
+    {
+        for (unsigned int ndx = 0; ndx < max_hazards; ndx++)
+        {
+            if (hazards[ndx].ptr.load(std::memory_order_seq_cst) == seg)
+                return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief move retired segments w/o hazard pointers to the cache, cache_mutex held
+     */
+    void reclaim()
+    {
+        size_t k = 0;
+        for (segment* seg : retired)
+        {
+            if (hazardous(seg))
+                retired[k++] = seg;
+            else if (cache.size() < cache_size && seg->capacity == capacity.load(std::memory_order_relaxed))
+            {
+                seg->reset();
+                seg->next.store(nullptr, std::memory_order_relaxed);
+                cache.push_back(seg);
+            }
+            else
+                delete seg;
+        }
+        retired.resize(k);
+    }
+
+    /**
+     * @brief get empty segment from cache or allocate a new one
+     */
+    segment* alloc_segment()
+    {
+        {
+            std::lock_guard lk(cache_mutex);
+            if (cache.empty() && !retired.empty())
+                reclaim();
+            while (!cache.empty())
+            {
+                segment* seg = cache.back();
+                cache.pop_back();
+                if (seg->capacity == capacity.load(std::memory_order_relaxed))
+                    return seg;
+                delete seg;     // from before resize
+            }
+        }
+        return new segment(capacity.load(std::memory_order_relaxed), layout, stats_counter);
+    }
+
+    /**
+     * @brief return unpublished segment to cache
+     */
+    void free_segment(segment* seg)
+    {
+        seg->reset();
+        seg->next.store(nullptr, std::memory_order_relaxed);
+
+        std::lock_guard lk(cache_mutex);
+        if (cache.size() < cache_size && seg->capacity == capacity.load(std::memory_order_relaxed))
+            cache.push_back(seg);
+        else
+            delete seg;
+    }
+
+    /**
+     * @brief retire segment unlinked from the queue
+     */
+    void retire_segment(segment* seg)
+    {
+        std::lock_guard lk(cache_mutex);
+        retired.push_back(seg);
+        reclaim();
+    }
+
+public:
+
+    /**
+     * @brief create unbounded lock-free queue
+     * @param capacity of segments, must be power of 2 and >= 2 (>= 4 for mpmc_faa)
+     * @param cache_size max number of empty segments kept for reuse
+     * @param layout segment ring buffer node layout
+     * @param bounded return full instead of appending segments, see resize()
+     * @throws invalid_argument if capacity not power of 2 or capacity is too small
+     */
+    explicit ulfrbq(uint32_t capacity, unsigned int cache_size = 2, lfrbq_layout layout = linear_layout, bool bounded = false) :
+        capacity(capacity),
+        layout(layout),
+        cache_size(cache_size),
+        bounded(bounded)
+    {
+        segment* seg = new segment(capacity, layout, stats_counter);
+        head_segment.store(seg, std::memory_order_relaxed);
+        tail_segment.store(seg, std::memory_order_relaxed);
+    }
+
+    ~ulfrbq()
+    {
+        segment* seg = head_segment.load(std::memory_order_relaxed);
+        while (seg != nullptr && seg != closed_link)
+        {
+            segment* next = seg->next.load(std::memory_order_relaxed);
+            delete seg;
+            seg = next;
+        }
+        for (segment* seg : cache)
+            delete seg;
+        for (segment* seg : retired)
+            delete seg;
+    }
+
+    ulfrbq(const ulfrbq&) = delete;
+    ulfrbq& operator =(const ulfrbq&) = delete;
+
+    /**
+     * @brief close the queue
+     *
+     * @note
+     * The tail segment is closed and its next link set to closed_link so
+     * no segment can be appended after it.  For sp queue types it has to be
+     * called from the producer thread, as lfrbq::close().
+     */
+    void close()
+    {
+        qclosed.store(true, std::memory_order_release);
+
+        hazard_t* hazard = acquire_hazard();
+        for (;;)
+        {
+            segment* seg = protect(tail_segment, hazard);
+            seg->close();
+
+            segment* next = nullptr;
+            if (seg->next.compare_exchange_strong(next, closed_link, std::memory_order_acq_rel))
+                break;
+            if (next == closed_link)
+                break;
+            tail_segment.compare_exchange_strong(seg, next, std::memory_order_acq_rel);
+        }
+        release_hazard(hazard);
+    }
+
+    /**
+     * @brief get queue closed status
+     */
+    bool closed() { return qclosed.load(std::memory_order_acquire); }
+
+    /**
+     * @brief queue statistics, summed over all threads and segments
+     */
+    lfrbq_stats_t stats() const { return stats_counter.snapshot(); }
+
+    /**
+     * @brief get capacity of new segments
+     */
+    uint32_t get_capacity() { return capacity.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief approximate number of values in all linked segments
+     *
+     * Holds cache_mutex so no segment in the list can be reclaimed while it
+     * walks the next links from the head segment.
+     */
+    uint32_t size()
+    {
+        std::lock_guard lk(cache_mutex);
+        uint64_t n = 0;
+        segment* seg = head_segment.load(std::memory_order_acquire);
+        while (seg != nullptr && seg != closed_link)
+        {
+            n += seg->count();
+            seg = seg->next.load(std::memory_order_acquire);
+        }
+        return n > UINT32_MAX ? UINT32_MAX : (uint32_t) n;
+    }
+
+    /**
+     * @brief change segment capacity
+     * @param new_capacity of segments, must be power of 2 and >= 2 (>= 4 for mpmc_faa)
+     * @retval true tail segment replaced w/ segment of new_capacity
+     * @retval false queue closed or tail segment already new_capacity
+     * @throws invalid_argument if new_capacity not power of 2 or new_capacity is too small
+     *
+     * @note
+     * The tail segment is closed and an empty segment of new_capacity appended.
+     * Values in the old segment are dequeued before the values in the new one
+     * and it's freed once it's drained.  A bounded queue's producers get full
+     * between the close and the append.  For sp queue types resize() closes
+     * the tail segment, so it has to be called from the producer thread.
+     */
+    bool resize(uint32_t new_capacity)
+    {
+        segment* new_seg = new segment(new_capacity, layout, stats_counter);
+
+        bool resized = false;
+        hazard_t* hazard = acquire_hazard();
+        for (;;)
+        {
+            segment* seg = protect(tail_segment, hazard);
+
+            segment* next = seg->next.load(std::memory_order_acquire);
+            if (next == closed_link)
+                break;
+            if (next != nullptr)
+            {
+                tail_segment.compare_exchange_strong(seg, next, std::memory_order_acq_rel);
+                continue;
+            }
+
+            if (seg->capacity == new_capacity)
+                break;
+
+            seg->close();
+
+            if (seg->next.compare_exchange_strong(next, new_seg, std::memory_order_acq_rel))
+            {
+                capacity.store(new_capacity, std::memory_order_relaxed);
+                tail_segment.compare_exchange_strong(seg, new_seg, std::memory_order_acq_rel);
+                resized = true;
+                break;
+            }
+        }
+        release_hazard(hazard);
+
+        if (!resized)
+            free_segment(new_seg);
+        return resized;
+    }
+
+    /**
+     * @brief set resize policy for poll_resize()
+     */
+    void set_resize_policy(const ulfrbq_resize_policy& policy)
+    {
+        this->policy = policy;
+        water_mark = 0;
+    }
+
+    /**
+     * @brief sample occupancy and resize queue per resize policy
+     * @return new capacity if queue was resized, 0 otherwise
+     *
+     * Meant to be called periodically from one thread, e.g. a timer.  The
+     * occupancy has to be past a water mark at every call for the dwell time.
+     * For sp queue types it has to be the producer thread, see resize().
+     */
+    uint32_t poll_resize()
+    {
+        uint32_t current = capacity.load(std::memory_order_relaxed);
+        double occupancy = (double) size() / current;
+
+        int mark = 0;
+        if (occupancy >= policy.high_water && current < policy.max_capacity)
+            mark = 1;
+        else if (occupancy <= policy.low_water && current > policy.min_capacity)
+            mark = -1;
+
+        auto now = std::chrono::steady_clock::now();
+        if (mark != water_mark)
+        {
+            water_mark = mark;
+            water_mark_time = now;
+            return 0;
+        }
+
+        if (mark == 0 || (now - water_mark_time) < policy.dwell)
+            return 0;
+
+        uint32_t new_capacity = mark > 0 ? current * 2 : current / 2;
+        water_mark = 0;
+        return resize(new_capacity) ? new_capacity : 0;
+    }
+
+    /**
+     * @brief enqueue a value
+     * @param value to be queued
+     * @retval lfrbq_status::success enqueue succeeded
+     * @retval lfrbq_status::full    enqueue failed - bounded queue full, or being resized
+     * @retval lfrbq_status::closed  enqueue failed - queue closed
+     */
+    lfrbq_status try_enqueue(uintptr_t value)
+    {
+        lfrbq_status status;
+        hazard_t* hazard = acquire_hazard();
+        for (;;)
+        {
+            segment* seg = protect(tail_segment, hazard);
+
+            segment* next = seg->next.load(std::memory_order_acquire);
+            if (next == closed_link)
+            {
+                status = lfrbq_status::closed;
+                break;
+            }
+            if (next != nullptr)
+            {
+                tail_segment.compare_exchange_strong(seg, next, std::memory_order_acq_rel);    // help advance tail
+                continue;
+            }
+
+            status = seg->try_enqueue(value);
+            if (status == lfrbq_status::success)
+                break;
+
+            if (bounded)
+            {
+                // full, or closed by resize() or close() before it linked the next segment
+                if (status == lfrbq_status::closed)
+                {
+                    if (seg->next.load(std::memory_order_acquire) != nullptr)
+                        continue;
+                    if (!closed())
+                        status = lfrbq_status::full;
+                }
+                break;
+            }
+
+            if (status == lfrbq_status::full)
+                seg->close();
+
+            if (seg->next.load(std::memory_order_acquire) != nullptr)
+                continue;           // appended by another producer
+
+            // segment full or closed, append new segment w/ value
+            segment* new_seg = alloc_segment();
+            new_seg->try_enqueue(value);
+
+            next = nullptr;
+            if (seg->next.compare_exchange_strong(next, new_seg, std::memory_order_acq_rel))
+            {
+                tail_segment.compare_exchange_strong(seg, new_seg, std::memory_order_acq_rel);
+                status = lfrbq_status::success;
+                break;
+            }
+
+            free_segment(new_seg);
+        }
+        release_hazard(hazard);
+        return status;
+    }
+
+    /**
+     * @brief dequeue a value
+     * @param value address for returned value
+     * @retval lfrbq_status::success dequeue succeeded
+     * @retval lfrbq_status::empty   dequeue failed - queue empty
+     * @retval lfrbq_status::closed  dequeue failed - queue is empty and closed
+     */
+    lfrbq_status try_dequeue(uintptr_t *value)
+    {
+        lfrbq_status status;
+        hazard_t* hazard = acquire_hazard();
+        for (;;)
+        {
+            segment* seg = protect(head_segment, hazard);
+
+            status = seg->try_dequeue(value);
+            if (status != lfrbq_status::closed)
+                break;
+
+            // segment closed and drained
+            segment* next = seg->next.load(std::memory_order_acquire);
+            if (next == nullptr)
+            {
+                status = lfrbq_status::empty;       // next segment not appended yet
+                break;
+            }
+            if (next == closed_link)
+            {
+                status = lfrbq_status::closed;
+                break;
+            }
+
+            segment* tail_copy = seg;
+            tail_segment.compare_exchange_strong(tail_copy, next, std::memory_order_acq_rel);     // tail mustn't reference retired segment
+            if (head_segment.compare_exchange_strong(seg, next, std::memory_order_acq_rel))
+            {
+                hazard->ptr.store(nullptr, std::memory_order_release);
+                retire_segment(seg);
+            }
+        }
+        release_hazard(hazard);
+        return status;
+    }
+
+};
+
+/*==*/
@@ -0,0 +1,317 @@
+/*
+   Copyright 2025 Joseph W. Seigh
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <type_traits>
+#include <atomic>
+#include <new>
+
+#include <stdint.h>
+
+#include <lfrbq.h>
+
+
+/**
+ * @brief zero-copy lock-free bounded queue
+ * @tparam T payload type, must be default constructible
+ * @tparam qtype queue type, one of mpmc, mpsc, spmc, or spsc
+ * @tparam node_t ring buffer node type, see lfrbq
+ *
+ * The queue owns a payload arena parallel to the ring buffer, one cache line
+ * aligned slot per node.  A producer reserves the slot for the tail position,
+ * writes the payload in place, and commits it.  A consumer acquires the slot
+ * for the head position, reads the payload in place, and releases it.  There
+ * are no allocator calls and nothing is copied through the node.
+ *
+ * The node sequence is used the same as in lfrbq, and the node value, which
+ * isn't needed to carry anything, holds the slot state.  A node is empty for
+ * a tail position if its sequence matches and it's idle, and full for a head
+ * position if its sequence matches and it's committed.  The slot isn't reused
+ * until the consumer releases it, so a node that is still reserved or acquired
+ * from the previous lap makes the queue full.  Positions are claimed by
+ * updating the node, and the head and tail are moved up afterwards by the
+ * claiming thread or any thread that finds them behind.
+ *
+ * Reserved slots that aren't committed hold up consumers at that position, and
+ * acquired slots that aren't released hold up producers, so reserve/commit and
+ * acquire/release should be short.  Slots are payload objects constructed w/
+ * the queue and destroyed w/ it, they are reused, not reconstructed.
+ */
+template<typename T, lfrbq_type qtype = mpmc, typename node_t = lfrbq_node>
+class zlfrbq : protected lfrbq<qtype, node_t>
+{
+    static_assert(qtype != runtime_qtype, "queue type must be fixed at compile time");
+    static_assert(qtype != mpmc_faa, "mpmc_faa not supported");
+    static_assert(std::is_default_constructible_v<T>, "payload type must be default constructible");
+
+    using base = lfrbq<qtype, node_t>;
+
+    using base::capacity;
+    using base::head;
+    using base::tail;
+    using base::rnode;
+    using base::seq2ndx;
+    using base::seq2node;
+    using base::xcmp;
+
+    /*
+     * slot states, kept in the node value
+     */
+    static constexpr uintptr_t slot_idle = 0;           // empty, available to producers
+    static constexpr uintptr_t slot_reserved = 1;       // claimed by producer, being written
+    static constexpr uintptr_t slot_committed = 2;      // full, available to consumers
+    static constexpr uintptr_t slot_acquired = 3;       // claimed by consumer, being read
+
+    struct alignas(64) slot_t
+    {
+        T payload;
+    };
+
+    lfrbq_buffer arena_mem;
+    slot_t* arena;
+
+    /**
+     * @brief slot index for payload address from try_reserve() or try_acquire()
+     */
+    unsigned int slot_ndx(const T* payload) { return (const slot_t*) payload - arena; }
+
+    /**
+     * @brief move head or tail up past pos if it's still at pos
+     */
+    static void advance(std::atomic<seq_t>& index, seq_t pos)
+    {
+        index.compare_exchange_strong(pos, pos + 1, std::memory_order_release, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief set slot state, slot owned by caller
+     * The close bit may be set on the node concurrently so it's preserved.
+     */
+    void set_state(unsigned int ndx, seq_t pos, uintptr_t old_state, uintptr_t new_state)
+    {
+        node_t& node = rnode(ndx);
+        for (;;)
+        {
+            seq_t node_seq = node.load_seq(pos, std::memory_order_relaxed);
+            if (node.compare_exchange(node_seq, old_state, node_seq, new_state))
+                return;
+        }
+    }
+
+public:
+
+    /**
+     * @brief create zero-copy lock-free bounded queue
+     * @param capacity of queue, must be power of 2 and >= 2
+     * @param layout ring buffer node layout
+     * @param alloc ring buffer and payload arena allocation options
+     * @throws invalid_argument if size not power of 2 or size is less than 2
+     * @throws bad_alloc if ring buffer or arena can't be allocated as requested by alloc
+     */
+    explicit zlfrbq(uint32_t capacity, lfrbq_layout layout = linear_layout, const lfrbq_alloc_options& alloc = {}) :
+        base(capacity, layout, alloc)
+    {
+        arena_mem = lfrbq_alloc_buffer((size_t) capacity * sizeof(slot_t), alloc);
+        arena = (slot_t*) arena_mem.addr;
+
+        for (unsigned int ndx = 0; ndx < capacity; ndx++)
+            new (&arena[ndx]) slot_t();
+    }
+
+    ~zlfrbq()
+    {
+        for (unsigned int ndx = 0; ndx < capacity; ndx++)
+            arena[ndx].~slot_t();
+        lfrbq_free_buffer(arena_mem);
+    }
+
+    zlfrbq(const zlfrbq&) = delete;
+    zlfrbq& operator =(const zlfrbq&) = delete;
+
+    using base::close;
+    using base::closed;
+    using base::drained;
+    using base::size;
+    using base::stats;
+
+    /**
+     * @brief reserve the slot at the tail of the queue
+     * @param payload address for returned slot payload, written in place and
+     * passed to commit()
+     * @retval lfrbq_status::success slot reserved
+     * @retval lfrbq_status::full    reserve failed - queue full
+     * @retval lfrbq_status::closed  reserve failed - queue closed
+     */
+    lfrbq_status try_reserve(T** payload)
+    {
+        for (;;)
+        {
+            seq_t tail_copy = tail.load(std::memory_order_acquire);
+            unsigned int ndx = seq2ndx(tail_copy);
+            node_t& node = rnode(ndx);
+
+            seq_t node_seq = node.load_seq(tail_copy, std::memory_order_acquire);
+            uintptr_t state = node.load_value(std::memory_order_relaxed);
+            if (node_seq & Q_CLOSED)
+                return lfrbq_status::closed;
+
+            int64_t cc = xcmp(node_seq, seq2node(tail_copy));
+            if (cc > 0) {                   // position claimed, tail behind
+                advance(tail, tail_copy);
+                continue;
+            }
+            else if (cc < 0) {              // stale tail
+                continue;
+            }
+
+            if (state != slot_idle)
+            {
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (node.load_seq(tail_copy, std::memory_order_relaxed) != node_seq)
+                    continue;               // state from a later node sequence
+                this->count_stat(&lfrbq_stats_t::queue_full_count);
+                return lfrbq_status::full;  // previous lap not consumed or not released
+            }
+
+            if (node.compare_exchange(node_seq, slot_idle, node_seq + capacity, slot_reserved))
+            {
+                std::atomic_thread_fence(std::memory_order_acquire);   // consumer release
+                advance(tail, tail_copy);
+                *payload = &arena[ndx].payload;
+                return lfrbq_status::success;
+            }
+
+            this->count_stat(&lfrbq_stats_t::producer_retries);
+        }
+    }
+
+    /**
+     * @brief commit a reserved slot, making it available to consumers
+     * @param payload from try_reserve()
+     */
+    void commit(T* payload)
+    {
+        unsigned int ndx = slot_ndx(payload);
+        set_state(ndx, tail.load(std::memory_order_relaxed), slot_reserved, slot_committed);
+    }
+
+    /**
+     * @brief acquire the slot at the head of the queue
+     * @param payload address for returned slot payload, read in place and
+     * passed to release()
+     * @retval lfrbq_status::success slot acquired
+     * @retval lfrbq_status::empty   acquire failed - queue empty
+     * @retval lfrbq_status::closed  acquire failed - queue is empty and closed
+     */
+    lfrbq_status try_acquire(T** payload)
+    {
+        for (;;)
+        {
+            seq_t head_copy = head.load(std::memory_order_acquire);
+            unsigned int ndx = seq2ndx(head_copy);
+            node_t& node = rnode(ndx);
+
+            seq_t node_seq = node.load_seq(head_copy, std::memory_order_acquire);
+            uintptr_t state = node.load_value(std::memory_order_relaxed);
+
+            int64_t cc = xcmp(node_seq & ~Q_CLOSED, seq2node(head_copy));
+            if (cc > 0)                     // stale head
+                continue;
+
+            if (cc == 0)
+            {
+                if (state == slot_committed)
+                {
+                    if (node.compare_exchange(node_seq, slot_committed, node_seq, slot_acquired))
+                    {
+                        std::atomic_thread_fence(std::memory_order_acquire);   // producer commit
+                        advance(head, head_copy);
+                        *payload = &arena[ndx].payload;
+                        return lfrbq_status::success;
+                    }
+                    this->count_stat(&lfrbq_stats_t::consumer_retries);
+                    continue;
+                }
+
+                if (state != slot_reserved)  // acquired or released, head behind
+                {
+                    advance(head, head_copy);
+                    continue;
+                }
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (node.load_seq(head_copy, std::memory_order_relaxed) != node_seq)
+                    continue;               // state from a later node sequence
+            }
+
+            // not enqueued or not committed yet
+            if (this->closed() && this->drained())
+                return lfrbq_status::closed;
+            this->count_stat(&lfrbq_stats_t::queue_empty_count);
+            return lfrbq_status::empty;
+        }
+    }
+
+    /**
+     * @brief release an acquired slot, making it available to producers
+     * @param payload from try_acquire()
+     */
+    void release(T* payload)
+    {
+        unsigned int ndx = slot_ndx(payload);
+        set_state(ndx, head.load(std::memory_order_relaxed), slot_acquired, slot_idle);
+    }
+
+    /**
+     * @brief enqueue a copy of a value, reserve, assign, and commit
+     * @retval lfrbq_status::success enqueue succeeded
+     * @retval lfrbq_status::full    enqueue failed - queue full
+     * @retval lfrbq_status::closed  enqueue failed - queue closed
+     */
+    lfrbq_status try_enqueue(const T& value)
+    {
+        T* payload;
+        lfrbq_status status = try_reserve(&payload);
+        if (status == lfrbq_status::success)
+        {
+            *payload = value;
+            commit(payload);
+        }
+        return status;
+    }
+
+    /**
+     * @brief dequeue a value, acquire, move assign, and release
+     * @retval lfrbq_status::success dequeue succeeded
+     * @retval lfrbq_status::empty   dequeue failed - queue empty
+     * @retval lfrbq_status::closed  dequeue failed - queue is empty and closed
+     */
+    lfrbq_status try_dequeue(T* value)
+    {
+        T* payload;
+        lfrbq_status status = try_acquire(&payload);
+        if (status == lfrbq_status::success)
+        {
+            *value = std::move(*payload);
+            release(payload);
+        }
+        return status;
+    }
+
+};
+
+/*==*/
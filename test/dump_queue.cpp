@@ -26,8 +26,8 @@
 
 #include <eventcount.h>
 
-static const char* qtype_names[] = {"mpmc", "mpsc", "spmc", "spsc", NULL};
-static const lfrbq_type qtype[] = {mpmc, mpsc, spmc, spsc};
+static const char* qtype_names[] = {"mpmc", "mpsc", "spmc", "spsc", "mpmc_faa", NULL};
+static const lfrbq_type qtype[] = {mpmc, mpsc, spmc, spsc, mpmc_faa};
 
 static lfrbq_type find_qtype(char* opt)
 {
@@ -52,7 +52,7 @@ static lfrbq_type find_qtype(char* opt)
     static const string help_usage(
         "interactive queue tester\n"
         "usage: cmd <queue_type>\n"
-        "  where queue_type = mpmc|mpsc|spmc|spsc (default mpmc)\n"
+        "  where queue_type = mpmc|mpsc|spmc|spsc|mpmc_faa (default mpmc)\n"
     );
     static const string help_text(
         "commands:\n"
@@ -89,14 +89,15 @@ const char* status_str(lfrbq_status status)
     case lfrbq_status::empty: return "empty";
     case lfrbq_status::closed: return "closed";
     case lfrbq_status::fail: return "fail";
+    case lfrbq_status::timedout: return "timedout";
     default: return "?";
     }
 }
 
-class lfrbtest : public lfrbq
+class lfrbtest : public lfrbq<>
 {
 public:
-    using lfrbq::lfrbq;
+    using lfrbq<>::lfrbq;
 
     // unsigned int get_size()
     // {
@@ -108,7 +109,7 @@ public:
     {
         fprintf(out, "%s:\n", label.c_str());
         seq_t head_copy = head.load(std::memory_order_relaxed);
-        seq_t tail_copy = tail.load(std::memory_order_relaxed);
+        seq_t tail_copy = tail.load(std::memory_order_relaxed) & ~Q_TAIL_CLOSED;      // mpmc_faa closed bit
         uint32_t q_size = (tail_copy + capacity) - head_copy;
 
         fprintf(out, "  head = %llu head.seq=%llu head.ndx=%u\n", head_copy, seq2node(head_copy), seq2ndx(head_copy));
@@ -118,12 +119,12 @@ public:
 
         for (unsigned int ndx = 0; ndx < capacity; ndx++)
         {
-            seq_t node_seq = rbuffer[ndx].seq.load(std::memory_order_relaxed);
+            seq_t node_seq = rbuffer()[ndx].seq.load(std::memory_order_relaxed);
             seq_t node_vseq = seq2node(node_seq) + ndx;
             fprintf(out, "  node[%02d]: seq=%04llu (%04llu) value=%llu\n",
                 ndx,
                 node_seq, node_vseq,
-                rbuffer[ndx].value.load(std::memory_order_relaxed),
+                rbuffer()[ndx].value.load(std::memory_order_relaxed),
                 1);
         }
         fprintf(out, "\n\n");
@@ -149,7 +150,7 @@ public:
         seq_t tail_copy = tail.load(std::memory_order_relaxed);
         int ndx = seq2ndx(tail_copy);
         seq_t tail_seq = seq2node(tail_copy);
-        seq_t node_seq = rbuffer[ndx].seq.load(std::memory_order_relaxed);
+        seq_t node_seq = rbuffer()[ndx].seq.load(std::memory_order_relaxed);
         fprintf(stdout, "enqueue: tail=%llu tail.seq=%llu, ndx=%u node.seq=%llu -- head=%llu head.seq=%llu head_ndx=%u\n",
             tail_copy,
             tail_seq,
@@ -170,7 +171,7 @@ public:
         seq_t head_copy = head.load(std::memory_order_relaxed);
         int ndx = seq2ndx(head_copy);
         seq_t head_seq = seq2node(head_copy);
-        seq_t node_seq = rbuffer[ndx].seq.load(std::memory_order_relaxed);
+        seq_t node_seq = rbuffer()[ndx].seq.load(std::memory_order_relaxed);
         fprintf(stdout, "dequeue: head=%llu head.seq=%llu, ndx=%u node.seq=%llu\n",
             head_copy,
             head_seq,
@@ -0,0 +1,114 @@
+/*
+   Copyright 2025 Joseph W. Seigh
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <atomic>
+
+#include <stdint.h>
+
+
+/**
+ * @brief log linear latency histogram, HDR histogram style
+ *
+ * Values below 2^sub_bits have their own bucket.  Above that each power of 2
+ * range is split into 2^(sub_bits - 1) buckets, so a bucket is w/in ~3% of
+ * the values in it.  All 64 bit values fit, there's no overflow bucket.
+ */
+struct latency_histogram_t
+{
+    static constexpr unsigned int sub_bits = 6;
+    static constexpr unsigned int sub_count = 1u << sub_bits;
+    static constexpr unsigned int half_count = sub_count / 2;
+    static constexpr unsigned int nbuckets = half_count * (64 - sub_bits + 2);
+
+    uint64_t buckets[nbuckets];
+    uint64_t count;
+    uint64_t max;
+
+    static unsigned int bucket(uint64_t value)
+    {
+        if (value < sub_count)
+            return value;
+        unsigned int shift = (63 - __builtin_clzll(value)) - sub_bits + 1;
+        return (shift * half_count) + (value >> shift);
+    }
+
+    /**
+     * @brief highest value in bucket
+     */
+    static uint64_t bucket_value(unsigned int ndx)
+    {
+        if (ndx < sub_count)
+            return ndx;
+        unsigned int shift = (ndx / half_count) - 1;
+        uint64_t sub = (ndx % half_count) + half_count;
+        return ((sub + 1) << shift) - 1;
+    }
+
+    inline void record(uint64_t value)
+    {
+        buckets[bucket(value)]++;
+        count++;
+        if (value > max)
+            max = value;
+    }
+
+    /**
+     * @brief add other histogram, w/ atomic adds so threads can merge into a shared histogram
+     */
+    void merge(const latency_histogram_t& other)
+    {
+        for (unsigned int ndx = 0; ndx < nbuckets; ndx++)
+            if (other.buckets[ndx] != 0)
+                std::atomic_ref<uint64_t>(buckets[ndx]).fetch_add(other.buckets[ndx], std::memory_order_relaxed);
+        std::atomic_ref<uint64_t>(count).fetch_add(other.count, std::memory_order_relaxed);
+
+        std::atomic_ref<uint64_t> xmax(max);
+        uint64_t current = xmax.load(std::memory_order_relaxed);
+        while (other.max > current && !xmax.compare_exchange_weak(current, other.max, std::memory_order_relaxed))
+            ;
+    }
+
+    /**
+     * @brief value at percentile
+     * @param pct percentile, 0 to 100
+     * @return highest value of the bucket w/ the percentile, at most max
+     */
+    uint64_t percentile(double pct)
+    {
+        if (count == 0)
+            return 0;
+
+        uint64_t target = (uint64_t) ((pct / 100.0) * count + 0.5);
+        if (target == 0)
+            target = 1;
+
+        uint64_t sum = 0;
+        for (unsigned int ndx = 0; ndx < nbuckets; ndx++)
+        {
+            sum += buckets[ndx];
+            if (sum >= target)
+            {
+                uint64_t value = bucket_value(ndx);
+                return value < max ? value : max;
+            }
+        }
+        return max;
+    }
+};
+
+/*==*/
@@ -17,6 +17,7 @@
 #include <atomic>
 #include <thread>
 #include <latch>
+#include <vector>
 
 #include <time.h>
 #include <sys/resource.h>
@@ -24,7 +25,9 @@
 #include <locale.h>
 
 #include <rbq.h>
+#include <srbq.h>
 #include <testconfig.h>
+#include <histogram.h>
 
 static inline uint64_t timeval_nsecs(struct timeval *t)
 {
@@ -66,6 +69,8 @@ struct stats_t {
 
         lfrbq_stats_t lfrbq_stats;
 
+        latency_histogram_t latency;    // enqueue to dequeue latency, nsecs
+
 };
 
 template<typename T, typename V>
@@ -94,20 +99,34 @@ static void update_stats(stats_t& stats, stats_t& local_stats)
     atomic_fetch_add(stats.producer_sums, local_stats.producer_sums);
     atomic_fetch_add(stats.consumer_sums, local_stats.consumer_sums);
 
-    atomic_fetch_add(stats.lfrbq_stats.queue_full_count, tls_lfrbq_stats.queue_full_count);
-    atomic_fetch_add(stats.lfrbq_stats.queue_empty_count, tls_lfrbq_stats.queue_empty_count);
-    atomic_fetch_add(stats.lfrbq_stats.producer_waits, tls_lfrbq_stats.producer_waits);
-    atomic_fetch_add(stats.lfrbq_stats.consumer_waits, tls_lfrbq_stats.consumer_waits);
-    atomic_fetch_add(stats.lfrbq_stats.producer_retries, tls_lfrbq_stats.producer_retries);
-    atomic_fetch_add(stats.lfrbq_stats.consumer_retries, tls_lfrbq_stats.consumer_retries);
-    atomic_fetch_add(stats.lfrbq_stats.producer_wraps, tls_lfrbq_stats.producer_wraps);
-    atomic_fetch_add(stats.lfrbq_stats.consumer_wraps, tls_lfrbq_stats.consumer_wraps);
+    if (local_stats.latency.count > 0)
+        stats.latency.merge(local_stats.latency);
+}
+
+/**
+ * @brief message value, CLOCK_MONOTONIC enqueue timestamp if measuring latency
+ * Compact nodes only carry the low 32 bits of the timestamp.
+ */
+static inline uintptr_t message_value(testconfig_t* config, uint32_t ndx)
+{
+    if (!config->latency)
+        return ndx;
+    uint64_t timestamp = gettime();
+    return config->compact ? (uint32_t) timestamp : timestamp;
+}
 
-    atomic_fetch_add(stats.lfrbq_stats.invalid_head_sync, tls_lfrbq_stats.invalid_head_sync);
+/**
+ * @brief enqueue to dequeue latency of a message from message_value()
+ */
+static inline uint64_t message_latency(testconfig_t* config, uint64_t now, uintptr_t value)
+{
+    uint64_t latency = now - value;
+    return config->compact ? (uint32_t) latency : latency;
 }
 
 
-void producer(rbq* queue, std::latch* latch, stats_t* stats, testconfig_t* config)
+template<typename Q>
+void producer(Q* queue, std::latch* latch, stats_t* stats, testconfig_t* config)
 {
     stats_t local_stats = {};
 
@@ -117,14 +136,39 @@ void producer(rbq* queue, std::latch* latch, stats_t* stats, testconfig_t* confi
 
     uint64_t t0 = getcputime();
     
-    for (uint32_t ndx = 0; ndx < count; ndx++)
+    if (config->batch > 1)
+    {
+        std::vector<uintptr_t> values(config->batch);
+
+        for (uint32_t ndx = 0; ndx < count; )
+        {
+            uint32_t n = std::min(config->batch, count - ndx);
+            for (uint32_t ndx2 = 0; ndx2 < n; ndx2++)
+                values[ndx2] = message_value(config, ndx + ndx2);
+
+            uint32_t k = queue->enqueue_bulk(values.data(), n);
+            for (uint32_t ndx2 = 0; ndx2 < k; ndx2++)
+                local_stats.producer_sums += values[ndx2];
+            local_stats.enqueue_count += k;
+
+            if (k < n)
+                break;
+            ndx += n;
+        }
+    }
+
+    else
     {
-        lfrbq_status status = queue->enqueue(ndx);
-        if (status != lfrbq_status::success)
-            break;
-        
-        local_stats.producer_sums += ndx;
-        local_stats.enqueue_count++;
+        for (uint32_t ndx = 0; ndx < count; ndx++)
+        {
+            uintptr_t value = message_value(config, ndx);
+            lfrbq_status status = queue->enqueue(value);
+            if (status != lfrbq_status::success)
+                break;
+
+            local_stats.producer_sums += value;
+            local_stats.enqueue_count++;
+        }
     }
 
     uint64_t t1 = getcputime();
@@ -134,7 +178,8 @@ void producer(rbq* queue, std::latch* latch, stats_t* stats, testconfig_t* confi
     update_stats(*stats, local_stats);
 }
 
-void consumer(rbq* queue, std::latch* latch, stats_t* stats, testconfig_t* config)
+template<typename Q>
+void consumer(Q* queue, std::latch* latch, stats_t* stats, testconfig_t* config)
 {
     stats_t local_stats = {};
 
@@ -142,15 +187,44 @@ void consumer(rbq* queue, std::latch* latch, stats_t* stats, testconfig_t* confi
 
     uint64_t t0 = getcputime();
     
-    for (;;)
+    if (config->batch > 1)
     {
-        uintptr_t value;
-        lfrbq_status status = queue->dequeue(&value);
-        if (status != lfrbq_status::success)
-            break;
-        
-        local_stats.consumer_sums += value;
-        local_stats.dequeue_count++;
+        std::vector<uintptr_t> values(config->batch);
+
+        for (;;)
+        {
+            uint32_t n = queue->dequeue_bulk(values.data(), config->batch);
+            if (n == 0)
+                break;
+
+            if (config->latency)
+            {
+                uint64_t now = gettime();
+                for (uint32_t ndx = 0; ndx < n; ndx++)
+                    local_stats.latency.record(message_latency(config, now, values[ndx]));
+            }
+
+            for (uint32_t ndx = 0; ndx < n; ndx++)
+                local_stats.consumer_sums += values[ndx];
+            local_stats.dequeue_count += n;
+        }
+    }
+
+    else
+    {
+        for (;;)
+        {
+            uintptr_t value;
+            lfrbq_status status = queue->dequeue(&value);
+            if (status != lfrbq_status::success)
+                break;
+
+            if (config->latency)
+                local_stats.latency.record(message_latency(config, gettime(), value));
+
+            local_stats.consumer_sums += value;
+            local_stats.dequeue_count++;
+        }
     }
 
     uint64_t t1 = getcputime();
@@ -161,22 +235,15 @@ void consumer(rbq* queue, std::latch* latch, stats_t* stats, testconfig_t* confi
 }
 
 static void print_stats(FILE *out, testconfig_t& config, stats_t& stats);
+static void print_sync_stats(FILE *out, testconfig_t& config, stats_t& stats, bool header);
 
 
-int main(int argc, char** argv)
+/**
+ * @brief run producers and consumers on queue
+ */
+template<typename Q>
+static void run_test(Q& queue, testconfig_t& config, stats_t& stats)
 {
-    stats_t stats = {};
-    testconfig_t config;
-
-    uint64_t elapsed;
-
-    bool rc = parse_options(&config, argc, argv);
-    if (!rc) {
-        return 1;
-    }
-
-    rbq queue(config.capacity, config.qtype, config.sync);
-
     std::thread producers[config.nproducers];
     std::thread consumers[config.nconsumers];
 
@@ -185,12 +252,12 @@ int main(int argc, char** argv)
 
     for (int ndx = 0; ndx < config.nproducers; ndx++)
     {
-        producers[ndx] = std::thread(producer, &queue, &latch, &stats, &config);
+        producers[ndx] = std::thread(producer<Q>, &queue, &latch, &stats, &config);
     }
 
     for (int ndx = 0; ndx < config.nconsumers; ndx++)
     {
-        consumers[ndx] = std::thread(consumer, &queue, &latch, &stats, &config);
+        consumers[ndx] = std::thread(consumer<Q>, &queue, &latch, &stats, &config);
     }
 
     latch.arrive_and_wait();
@@ -212,6 +279,106 @@ int main(int argc, char** argv)
     uint64_t x1 = gettime();
     stats.elapsed = (x1 - x0);
 
+    stats.lfrbq_stats = queue.stats();
+}
+
+/**
+ * @brief run test on queue w/ queue type and sync type fixed at compile time
+ */
+template<lfrbq_type qtype, typename node_t>
+static void run_static_test(testconfig_t& config, stats_t& stats)
+{
+    switch (config.sync)
+    {
+        case rbq_sync::eventcount: { rbq<qtype, rbq_sync::eventcount, node_t> queue(config.capacity, config.layout, config.alloc); run_test(queue, config, stats); break; }
+        case rbq_sync::mutex: { rbq<qtype, rbq_sync::mutex, node_t> queue(config.capacity, config.layout, config.alloc); run_test(queue, config, stats); break; }
+        case rbq_sync::yield: { rbq<qtype, rbq_sync::yield, node_t> queue(config.capacity, config.layout, config.alloc); run_test(queue, config, stats); break; }
+        case rbq_sync::semaphore: { rbq<qtype, rbq_sync::semaphore, node_t> queue(config.capacity, config.layout, config.alloc); run_test(queue, config, stats); break; }
+        case rbq_sync::atomic32: { rbq<qtype, rbq_sync::atomic32, node_t> queue(config.capacity, config.layout, config.alloc); run_test(queue, config, stats); break; }
+        case rbq_sync::adaptive: { rbq<qtype, rbq_sync::adaptive, node_t> queue(config.capacity, config.layout, config.alloc); run_test(queue, config, stats); break; }
+        case rbq_sync::handoff: { rbq<qtype, rbq_sync::handoff, node_t> queue(config.capacity, config.layout, config.alloc); run_test(queue, config, stats); break; }
+        case rbq_sync::readiness: { rbq<qtype, rbq_sync::readiness, node_t> queue(config.capacity, config.layout, config.alloc); run_test(queue, config, stats); break; }
+        case rbq_sync::async: { rbq<qtype, rbq_sync::async, node_t> queue(config.capacity, config.layout, config.alloc); run_test(queue, config, stats); break; }
+        default: break;
+    }
+}
+
+/**
+ * @brief run test on queue w/ node type node_t
+ */
+template<typename node_t>
+static void run_node_test(testconfig_t& config, stats_t& stats)
+{
+    if (config.shards > 0)
+    {
+        srbq<runtime_qtype, node_t> queue(config.shards, config.capacity, config.qtype, config.layout, config.alloc);
+        run_test(queue, config, stats);
+    }
+
+    else if (config.static_types)
+    {
+        switch (config.qtype)
+        {
+            case mpmc: run_static_test<mpmc, node_t>(config, stats); break;
+            case mpsc: run_static_test<mpsc, node_t>(config, stats); break;
+            case spmc: run_static_test<spmc, node_t>(config, stats); break;
+            case spsc: run_static_test<spsc, node_t>(config, stats); break;
+            case mpmc_faa: run_static_test<mpmc_faa, node_t>(config, stats); break;
+            default: break;
+        }
+    }
+
+    else
+    {
+        rbq<runtime_qtype, runtime_sync, node_t> queue(config.capacity, config.qtype, config.sync, config.layout, config.alloc);
+        run_test(queue, config, stats);
+    }
+}
+
+
+/**
+ * @brief run test w/ node type per config
+ */
+static void run_config_test(testconfig_t& config, stats_t& stats)
+{
+    if (config.compact)
+        run_node_test<lfrbq_compact_node>(config, stats);
+    else
+        run_node_test<lfrbq_node>(config, stats);
+}
+
+
+int main(int argc, char** argv)
+{
+    stats_t stats = {};
+    testconfig_t config;
+
+    bool rc = parse_options(&config, argc, argv);
+    if (!rc) {
+        return 1;
+    }
+
+    try {
+        if (config.all_sync)
+        {
+            for (int ndx = 0; sync_names[ndx] != NULL; ndx++)
+            {
+                config.sync = sync_values[ndx];
+                config.sync_name = sync_names[ndx];
+                stats = {};
+                run_config_test(config, stats);
+                print_sync_stats(stdout, config, stats, ndx == 0);
+            }
+            return 0;
+        }
+
+        run_config_test(config, stats);
+    }
+    catch (const std::bad_alloc& e) {
+        fprintf(stderr, "ring buffer allocation failed, pages=%s numa=%s (huge pages reserved?)\n", config.pages_name, config.numa_name);
+        return 1;
+    }
+
     print_stats(stdout, config, stats);
 
 
@@ -230,6 +397,14 @@ static const char* zz(uint64_t a, uint64_t b)
 }
 
 
+static void print_latency(FILE *out, stats_t& stats)
+{
+    latency_histogram_t& h = stats.latency;
+    fprintf(out, "  latency p50 = %'lu p90 = %'lu p99 = %'lu p99.9 = %'lu max = %'lu nsecs\n",
+        h.percentile(50), h.percentile(90), h.percentile(99), h.percentile(99.9), h.max);
+}
+
+
 static void print_stats(FILE *out, testconfig_t& config, stats_t& stats)
 {
 
@@ -246,6 +421,8 @@ static void print_stats(FILE *out, testconfig_t& config, stats_t& stats)
         double avg_overall = avg(stats.elapsed, stats.enqueue_count, 1);
         double aggregate_rate = avg_overall == 0.0 ? 0.0 : 1e9 / avg_overall;
         fprintf(out, "  overall rate = %'10.4f /sec\n", aggregate_rate);
+        if (config.latency)
+            print_latency(out, stats);
     }
 
     else
@@ -265,6 +442,8 @@ static void print_stats(FILE *out, testconfig_t& config, stats_t& stats)
         uint64_t count = config.count;
         uint64_t nprod = config.nproducers;
         uint64_t expected_sums = ((count * (count - 1))/2) * nprod;
+        if (config.latency)
+            expected_sums = stats.producer_sums;        // timestamps
         fprintf(out, "  producer message sums = %'llu %s %'llu (expected)\n", stats.producer_sums, zz(stats.producer_sums, expected_sums), expected_sums);
         fprintf(out, "  consumer message sums = %'llu %s %'llu (expected)\n", stats.consumer_sums, zz(stats.consumer_sums, expected_sums), expected_sums);
 
@@ -315,10 +494,30 @@ static void print_stats(FILE *out, testconfig_t& config, stats_t& stats)
         fprintf(out, "  producer retries  = %lu\n", stats.lfrbq_stats.producer_retries);
         fprintf(out, "  consumer retries  = %lu\n", stats.lfrbq_stats.consumer_retries);
 
+        if (config.qtype == mpmc_faa)
+        {
+            fprintf(out, "  producer skips    = %lu\n", stats.lfrbq_stats.producer_skips);
+            fprintf(out, "  consumer skips    = %lu\n", stats.lfrbq_stats.consumer_skips);
+        }
+
         fprintf(out, "  producer wraps    = %lu\n", stats.lfrbq_stats.producer_wraps);
         fprintf(out, "  consumer wraps    = %lu\n", stats.lfrbq_stats.consumer_wraps);
+        fprintf(out, "  consumer steals   = %lu\n", stats.lfrbq_stats.consumer_steals);
 
         fprintf(out, "  invalid head sync = %lu\n", stats.lfrbq_stats.invalid_head_sync);
+
+        if (config.sync == rbq_sync::adaptive)
+        {
+            fprintf(out, "  waits resolved spinning = %lu\n", stats.lfrbq_stats.spin_resolved);
+            fprintf(out, "  waits resolved yielding = %lu\n", stats.lfrbq_stats.yield_resolved);
+            fprintf(out, "  waits resolved parked   = %lu\n", stats.lfrbq_stats.park_resolved);
+        }
+
+        if (config.latency)
+        {
+            fprintf(out, "\n  -- enqueue to dequeue latency --\n");
+            print_latency(out, stats);
+        }
     }
 
     uselocale(prevlocale);
@@ -326,3 +525,26 @@ static void print_stats(FILE *out, testconfig_t& config, stats_t& stats)
 
 }
 
+
+/**
+ * @brief one line of sync type comparison, -x all
+ */
+static void print_sync_stats(FILE *out, testconfig_t& config, stats_t& stats, bool header)
+{
+    if (header)
+    {
+        fprintf(out, "%-10s %14s %6s %12s %12s %12s %12s %12s %12s %12s\n", "sync", "rate/sec", "ok", "p50", "p90", "p99", "p99.9", "max", "vcsw", "sys msecs");
+    }
+
+    uint64_t count = config.count;
+    uint64_t expected = config.latency ? stats.producer_sums : ((count * (count - 1))/2) * config.nproducers;
+    bool ok = stats.enqueue_count == config.count * config.nproducers && stats.dequeue_count == stats.enqueue_count
+        && stats.producer_sums == expected && stats.consumer_sums == expected;
+
+    double avg_overall = avg(stats.elapsed, stats.enqueue_count, 1);
+    double aggregate_rate = avg_overall == 0.0 ? 0.0 : 1e9 / avg_overall;
+
+    latency_histogram_t& h = stats.latency;
+    fprintf(out, "%-10s %14.1f %6s %12lu %12lu %12lu %12lu %12lu %12u %12.3f\n", config.sync_name, aggregate_rate, ok ? "yes" : "NO",
+        h.percentile(50), h.percentile(90), h.percentile(99), h.percentile(99.9), h.max, stats.ru_nvcsw, stats.ru_stime / 1e6);
+}
@@ -0,0 +1,1742 @@
+/*
+   Copyright 2025 Joseph W. Seigh
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+/*
+ * basic checks of each queue type, FIFO order, full/empty/closed status,
+ * and drain after close, and concurrent count and sum checks.  Exits w/
+ * non-zero status if any check fails.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <stdio.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include <lfrbq.h>
+#include <rbq.h>
+#include <tlfrbq.h>
+#include <ulfrbq.h>
+#include <shmq.h>
+#include <zlfrbq.h>
+#include <prbq.h>
+#include <srbq.h>
+#include <futex_semaphore.h>
+#include <rbq_waitset.h>
+
+static int failures = 0;
+
+#define CHECK(name, cond) check(name, cond, #cond, __LINE__)
+
+static void check(const char* name, bool ok, const char* text, int line)
+{
+    if (!ok)
+    {
+        fprintf(stderr, "%s: check failed line %d: %s\n", name, line, text);
+        failures++;
+    }
+}
+
+
+/**
+ * @brief fill, check full, drain in order, check empty, then close w/ values queued
+ * @param capacity values that fit, 0 for unbounded
+ */
+template<typename Q>
+static void check_fifo(const char* name, Q& queue, uint32_t capacity)
+{
+    uint32_t count = capacity != 0 ? capacity : 100;
+    uintptr_t value;
+
+    for (uint32_t ndx = 1; ndx <= count; ndx++)
+        CHECK(name, queue.try_enqueue(ndx) == lfrbq_status::success);
+    if (capacity != 0)
+        CHECK(name, queue.try_enqueue(0) == lfrbq_status::full);
+
+    for (uint32_t ndx = 1; ndx <= count; ndx++)
+        CHECK(name, queue.try_dequeue(&value) == lfrbq_status::success && value == ndx);
+    CHECK(name, queue.try_dequeue(&value) == lfrbq_status::empty);
+
+    CHECK(name, queue.try_enqueue(1) == lfrbq_status::success);
+    CHECK(name, queue.try_enqueue(2) == lfrbq_status::success);
+    queue.close();
+    CHECK(name, queue.closed());
+    CHECK(name, queue.try_enqueue(3) == lfrbq_status::closed);
+    CHECK(name, queue.try_dequeue(&value) == lfrbq_status::success && value == 1);
+    CHECK(name, queue.try_dequeue(&value) == lfrbq_status::success && value == 2);
+    CHECK(name, queue.try_dequeue(&value) == lfrbq_status::closed);
+
+    printf("%-24s ok\n", name);
+}
+
+/**
+ * @brief bulk runs on a 16 node queue, full and partial runs, across the wrap, and after close
+ */
+template<typename Q>
+static void check_bulk(const char* name, Q& queue)
+{
+    uintptr_t values[32];
+    uintptr_t out[32];
+    for (uintptr_t ndx = 0; ndx < 32; ndx++)
+        values[ndx] = ndx + 1;
+
+    CHECK(name, queue.try_enqueue_bulk(values, 0) == 0);
+    CHECK(name, queue.try_enqueue_bulk(values, 10) == 10);
+    CHECK(name, queue.try_enqueue_bulk(values + 10, 10) == 6);     // partial, full after 6
+    CHECK(name, queue.try_enqueue_bulk(values + 16, 1) == 0);
+    CHECK(name, queue.try_enqueue(0) == lfrbq_status::full);
+
+    CHECK(name, queue.try_dequeue_bulk(out, 4) == 4 && out[0] == 1 && out[3] == 4);
+    CHECK(name, queue.try_dequeue_bulk(out, 32) == 12 && out[0] == 5 && out[11] == 16);     // partial, empty after 12
+    CHECK(name, queue.try_dequeue_bulk(out, 32) == 0);
+    CHECK(name, queue.try_dequeue(&out[0]) == lfrbq_status::empty);
+
+    // head and tail are at 16, runs wrap the ring buffer
+    for (int pass = 0; pass < 3; pass++)
+    {
+        CHECK(name, queue.try_enqueue_bulk(values, 12) == 12);
+        CHECK(name, queue.try_dequeue_bulk(out, 5) == 5 && out[0] == 1 && out[4] == 5);
+        CHECK(name, queue.try_enqueue_bulk(values + 12, 9) == 9);
+        CHECK(name, queue.try_dequeue_bulk(out, 32) == 16);
+        bool ordered = true;
+        for (uintptr_t ndx = 0; ndx < 16; ndx++)
+            ordered &= out[ndx] == ndx + 6;
+        CHECK(name, ordered);
+    }
+
+    CHECK(name, queue.try_enqueue_bulk(values, 3) == 3);
+    queue.close();
+    CHECK(name, queue.try_enqueue_bulk(values, 3) == 0);
+    CHECK(name, queue.try_dequeue_bulk(out, 8) == 3 && out[0] == 1 && out[2] == 3);
+    CHECK(name, queue.try_dequeue_bulk(out, 8) == 0);
+    CHECK(name, queue.try_dequeue(&out[0]) == lfrbq_status::closed);
+
+    printf("%-24s ok\n", name);
+}
+
+/**
+ * @brief enqueue a run w/ the bulk API, or one value if the run is 1 or the queue has no bulk API
+ * @return number of values enqueued
+ */
+template<typename Q>
+static uint32_t enqueue_run(Q& queue, const uintptr_t* values, uint32_t n)
+{
+    if constexpr (requires { queue.try_enqueue_bulk(values, n); })
+        if (n > 1)
+            return queue.try_enqueue_bulk(values, n);
+    return queue.try_enqueue(values[0]) == lfrbq_status::success;
+}
+
+/**
+ * @brief dequeue a run of up to n values, see enqueue_run()
+ * @return number of values dequeued
+ */
+template<typename Q>
+static uint32_t dequeue_run(Q& queue, uintptr_t* values, uint32_t n)
+{
+    if constexpr (requires { queue.try_dequeue_bulk(values, n); })
+        if (n > 1)
+            return queue.try_dequeue_bulk(values, n);
+    return queue.try_dequeue(values) == lfrbq_status::success;
+}
+
+/**
+ * @brief producers each enqueue 1 .. count, consumers dequeue until all are dequeued,
+ * check the total count and sum.  Full and empty queues yield, so it runs on one cpu.
+ * @param batch > 1 to use the bulk API w/ runs of up to batch values
+ */
+template<typename Q>
+static void check_mpmc(const char* name, Q& queue, int producers, int consumers, uintptr_t count, uint32_t batch = 1)
+{
+    const uintptr_t total = producers * count;
+    std::atomic<uintptr_t> dequeued = 0;
+    std::atomic<uintptr_t> dequeued_sum = 0;
+    std::vector<std::thread> threads;
+
+    for (int ndx = 0; ndx < producers; ndx++)
+        threads.emplace_back([&]() {
+            std::vector<uintptr_t> values(batch);
+            uintptr_t next = 1;
+            while (next <= count)
+            {
+                uint32_t n = std::min<uintptr_t>(batch, count - next + 1);
+                for (uint32_t k = 0; k < n; k++)
+                    values[k] = next + k;
+                uint32_t k = enqueue_run(queue, values.data(), n);
+                if (k == 0)
+                    std::this_thread::yield();
+                next += k;
+            }
+        });
+
+    for (int ndx = 0; ndx < consumers; ndx++)
+        threads.emplace_back([&]() {
+            std::vector<uintptr_t> values(batch);
+            uintptr_t sum = 0;
+            while (dequeued.load(std::memory_order_relaxed) < total)
+            {
+                uint32_t k = dequeue_run(queue, values.data(), batch);
+                if (k == 0)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+                for (uint32_t j = 0; j < k; j++)
+                    sum += values[j];
+                dequeued.fetch_add(k, std::memory_order_relaxed);
+            }
+            dequeued_sum.fetch_add(sum);
+        });
+
+    for (auto& thread : threads)
+        thread.join();
+
+    uintptr_t value;
+    CHECK(name, dequeued.load() == total);
+    CHECK(name, dequeued_sum.load() == producers * (count * (count + 1) / 2));
+    CHECK(name, queue.try_dequeue(&value) == lfrbq_status::empty);
+    printf("%-24s ok\n", name);
+}
+
+/**
+ * @brief producers each enqueue 1 .. count w/ the blocking enqueue, the queue is
+ * closed once they're done, and consumers dequeue w/ the blocking dequeue until
+ * it returns closed.  Checks the total count and sum.
+ * @param enqueue_fn enqueue(queue, value), blocking
+ * @param dequeue_fn dequeue(queue, &value), blocking
+ */
+template<typename Q, typename E, typename D>
+static void check_blocking(const char* name, Q& queue, int producers, int consumers, uintptr_t count, E enqueue_fn, D dequeue_fn)
+{
+    std::atomic<uintptr_t> dequeued = 0;
+    std::atomic<uintptr_t> dequeued_sum = 0;
+    std::atomic<int> failed = 0;
+    std::vector<std::thread> producer_threads;
+    std::vector<std::thread> consumer_threads;
+
+    for (int ndx = 0; ndx < consumers; ndx++)
+        consumer_threads.emplace_back([&]() {
+            uintptr_t value;
+            uintptr_t n = 0;
+            uintptr_t sum = 0;
+            while (dequeue_fn(queue, &value) == lfrbq_status::success)
+            {
+                sum += value;
+                n++;
+            }
+            dequeued.fetch_add(n);
+            dequeued_sum.fetch_add(sum);
+        });
+
+    for (int ndx = 0; ndx < producers; ndx++)
+        producer_threads.emplace_back([&]() {
+            for (uintptr_t value = 1; value <= count; value++)
+                if (enqueue_fn(queue, value) != lfrbq_status::success)
+                    failed++;
+        });
+
+    for (auto& thread : producer_threads)
+        thread.join();
+    queue.close();
+    for (auto& thread : consumer_threads)
+        thread.join();
+
+    CHECK(name, failed.load() == 0);
+    CHECK(name, dequeued.load() == producers * count);
+    CHECK(name, dequeued_sum.load() == producers * (count * (count + 1) / 2));
+    printf("%-24s ok\n", name);
+}
+
+/**
+ * @brief check_blocking() w/ the queue's enqueue(value) and dequeue(&value)
+ */
+template<typename Q>
+static void check_blocking(const char* name, Q& queue, int producers, int consumers, uintptr_t count)
+{
+    check_blocking(name, queue, producers, consumers, count,
+        [](Q& queue, uintptr_t value) { return queue.enqueue(value); },
+        [](Q& queue, uintptr_t* value) { return queue.dequeue(value); });
+}
+
+/**
+ * @brief one producer thread enqueue_bulk's 1 .. count in runs of 7, dequeue_bulk in runs of 5
+ * checks order, then dequeue_bulk returns 0 after close
+ */
+static void test_rbq_bulk()
+{
+    static const char* names[] = {"rbq bulk eventcount", "rbq bulk mutex", "rbq bulk yield", "rbq bulk semaphore",
+        "rbq bulk atomic32", "rbq bulk adaptive", "rbq bulk handoff", "rbq bulk readiness", "rbq bulk async"};
+    const uintptr_t count = 10000;
+
+    for (int sync = rbq_sync::eventcount; sync <= rbq_sync::async; sync++)
+    {
+        const char* name = names[sync];
+        rbq<> queue(16, mpmc, (rbq_sync) sync);
+
+        std::thread producer([&]() {
+            uintptr_t values[7];
+            for (uintptr_t next = 1; next <= count; next += 7)
+            {
+                uint32_t n = std::min<uintptr_t>(7, count - next + 1);
+                for (uint32_t k = 0; k < n; k++)
+                    values[k] = next + k;
+                if (queue.enqueue_bulk(values, n) != n)
+                    break;
+            }
+        });
+
+        uintptr_t values[5];
+        uintptr_t expected = 1;
+        bool ordered = true;
+        while (expected <= count)
+        {
+            uint32_t n = queue.dequeue_bulk(values, 5);
+            for (uint32_t k = 0; k < n; k++)
+                ordered &= values[k] == expected++;
+            if (n == 0)
+                break;
+        }
+        producer.join();
+        CHECK(name, ordered && expected == count + 1);
+
+        queue.close();
+        CHECK(name, queue.enqueue_bulk(values, 5) == 0);
+        CHECK(name, queue.dequeue_bulk(values, 5) == 0);
+        printf("%-24s ok\n", name);
+    }
+}
+
+/**
+ * @brief runs of 1 .. 16 values, and refills after full and empty, on a 16 node
+ * queue so the sp producer's cached head and the spsc consumer's cached tail are
+ * stale and have to be reloaded, across several wraps
+ */
+template<typename Q>
+static void check_cached(const char* name, Q& queue)
+{
+    uintptr_t next_in = 1;
+    uintptr_t next_out = 1;
+    uintptr_t value;
+    bool ok = true;
+
+    for (uint32_t run = 1; run <= 16; run++)
+    {
+        for (uint32_t ndx = 0; ndx < run; ndx++)
+            ok &= queue.try_enqueue(next_in++) == lfrbq_status::success;
+        for (uint32_t ndx = 0; ndx < run; ndx++)
+            ok &= queue.try_dequeue(&value) == lfrbq_status::success && value == next_out++;
+        ok &= queue.try_dequeue(&value) == lfrbq_status::empty;
+
+        while (queue.try_enqueue(next_in) == lfrbq_status::success)
+            next_in++;
+        ok &= next_in - next_out == 16;
+        ok &= queue.try_dequeue(&value) == lfrbq_status::success && value == next_out++;
+        ok &= queue.try_enqueue(next_in++) == lfrbq_status::success;        // head copy says full
+        ok &= queue.try_enqueue(next_in) == lfrbq_status::full;
+        while (queue.try_dequeue(&value) == lfrbq_status::success)
+            ok &= value == next_out++;
+        ok &= next_out == next_in;
+        ok &= queue.try_enqueue(next_in++) == lfrbq_status::success;        // tail copy says empty
+        ok &= queue.try_dequeue(&value) == lfrbq_status::success && value == next_out++;
+    }
+    CHECK(name, ok);
+    printf("%-24s ok\n", name);
+}
+
+template<lfrbq_type qtype>
+static void test_lfrbq(const char* fifo_name, const char* bulk_name)
+{
+    {
+        lfrbq<qtype> queue(16);
+        check_fifo(fifo_name, queue, 16);
+    }
+    {
+        lfrbq<qtype> queue(16);
+        check_bulk(bulk_name, queue);
+    }
+}
+
+/**
+ * @brief spread_layout maps each position to its own node, for capacities below
+ * and above the minimum for spreading, and bulk runs across the rotated nodes
+ */
+template<lfrbq_type qtype>
+static void test_spread(const char* name)
+{
+    char fifo_name[64];
+    for (uint32_t capacity : {4, 64, 1024})
+    {
+        lfrbq<qtype> queue(capacity, spread_layout);
+        snprintf(fifo_name, sizeof(fifo_name), "%s %u", name, capacity);
+        check_fifo(fifo_name, queue, capacity);
+    }
+
+    char bulk_name[64];
+    snprintf(bulk_name, sizeof(bulk_name), "%s bulk", name);
+    lfrbq<qtype> queue(16, spread_layout);
+    check_bulk(bulk_name, queue);
+}
+
+/**
+ * @brief compact node sequences widened across the 32 bit wrap, and the FIFO,
+ * bulk, and cached copy checks w/ compact nodes
+ */
+static void test_compact()
+{
+    const char* name = "lfrbq compact widen";
+    using node_t = lfrbq_compact_node;
+
+    CHECK(name, node_t::widen(0x00000010, 0x100000000) == 0x100000010);
+    CHECK(name, node_t::widen(0x00000010, 0x1fffffff0) == 0x200000010);        // ahead across the wrap
+    CHECK(name, node_t::widen(0xfffffff0, 0x200000010) == 0x1fffffff0);        // behind across the wrap
+    CHECK(name, node_t::widen(0xfffffff1, 0x200000010) == 0x1fffffff1);        // w/ the close bit
+    CHECK(name, node_t::widen(0x40000010, 0x1fffffff0) == 0x240000010);        // a max_capacity lap ahead
+    CHECK(name, node_t::widen(0xbffffff0, 0x200000010) == 0x1bffffff0);        // a max_capacity lap behind
+    printf("%-24s ok\n", name);
+
+    {
+        lfrbq<mpmc, node_t> queue(16);
+        check_fifo("lfrbq compact mpmc", queue, 16);
+    }
+    {
+        lfrbq<mpmc, node_t> queue(16);
+        check_bulk("lfrbq compact bulk mpmc", queue);
+    }
+    {
+        lfrbq<spsc, node_t> queue(16);
+        check_bulk("lfrbq compact bulk spsc", queue);
+    }
+    {
+        lfrbq<spsc, node_t> queue(16);
+        check_cached("lfrbq compact cached", queue);
+    }
+
+    name = "lfrbq compact values";
+    lfrbq<mpmc, node_t> queue(4);
+    uintptr_t value;
+    CHECK(name, queue.try_enqueue(0xffffffff) == lfrbq_status::success);
+    CHECK(name, queue.try_dequeue(&value) == lfrbq_status::success && value == 0xffffffff);
+    if constexpr (sizeof(uintptr_t) > 4)
+    {
+        CHECK(name, queue.try_enqueue((uintptr_t) 0x123456789) == lfrbq_status::success);      // truncated to 32 bits
+        CHECK(name, queue.try_dequeue(&value) == lfrbq_status::success && value == 0x23456789);
+    }
+    printf("%-24s ok\n", name);
+}
+
+/**
+ * @brief queues on mmap'd ring buffers, which start zeroed instead of being
+ * initialized by the ctor.  hugetlb pages and NUMA policies depend on the
+ * system, bad_alloc is expected when they aren't available.
+ */
+static void test_alloc()
+{
+    lfrbq_alloc_options thp;
+    thp.pages = thp_pages;
+    thp.prefault = true;
+    {
+        lfrbq<mpmc> queue(16, linear_layout, thp);
+        check_fifo("lfrbq thp mpmc", queue, 16);
+    }
+    {
+        lfrbq<mpmc_faa, lfrbq_compact_node> queue(16, linear_layout, thp);
+        check_bulk("lfrbq thp compact faa", queue);
+    }
+    {
+        rbq<> queue(16, spsc, rbq_sync::eventcount, spread_layout, thp);
+        check_fifo("rbq thp spsc", queue, 16);
+    }
+
+    const char* name = "lfrbq numa, hugetlb";
+    lfrbq_alloc_options numa;
+    numa.numa = numa_interleave;
+    numa.numa_nodes = 1;
+    lfrbq_alloc_options hugetlb;
+    hugetlb.pages = huge_2m;
+    for (const lfrbq_alloc_options& alloc : {numa, hugetlb})
+    {
+        try {
+            lfrbq<mpmc> queue(64, linear_layout, alloc);
+            uintptr_t value;
+            CHECK(name, queue.try_enqueue(1) == lfrbq_status::success);
+            CHECK(name, queue.try_dequeue(&value) == lfrbq_status::success && value == 1);
+        }
+        catch (const std::bad_alloc&) {}
+    }
+    printf("%-24s ok\n", name);
+}
+
+/**
+ * @brief dequeue_batch waits for min values, takes up to max until the timeout,
+ * returns fewer than min only when closed, returns right away w/ min 0 and an
+ * empty queue, for each sync type, and a count and
+ * sum check w/ consumers dequeuing in batches
+ */
+static void test_rbq_batch()
+{
+    static const char* names[] = {"rbq batch eventcount", "rbq batch mutex", "rbq batch yield", "rbq batch semaphore",
+        "rbq batch atomic32", "rbq batch adaptive", "rbq batch handoff", "rbq batch readiness", "rbq batch async"};
+    using namespace std::chrono_literals;
+
+    for (int sync = rbq_sync::eventcount; sync <= rbq_sync::async; sync++)
+    {
+        const char* name = names[sync];
+        rbq<> queue(16, mpmc, (rbq_sync) sync);
+        uintptr_t values[16];
+
+        for (uintptr_t ndx = 1; ndx <= 5; ndx++)
+            queue.enqueue(ndx);
+        CHECK(name, queue.dequeue_batch(values, 2, 16, 1ms) == 5 && values[0] == 1 && values[4] == 5);
+
+        std::thread producer([&]() {
+            std::this_thread::sleep_for(5ms);
+            for (uintptr_t ndx = 6; ndx <= 8; ndx++)
+                queue.enqueue(ndx);
+        });
+        CHECK(name, queue.dequeue_batch(values, 3, 3, 10s) == 3 && values[0] == 6 && values[2] == 8);
+        producer.join();
+
+        queue.enqueue(9);
+        auto start = rbq_clock::now();
+        CHECK(name, queue.dequeue_batch(values, 1, 8, 10ms) == 1 && values[0] == 9);
+        CHECK(name, rbq_clock::now() - start >= 10ms);
+
+        start = rbq_clock::now();
+        CHECK(name, queue.dequeue_batch(values, 0, 8, 10s) == 0);      // empty, doesn't wait
+        CHECK(name, rbq_clock::now() - start < 5s);
+        queue.enqueue(12);
+        CHECK(name, queue.dequeue_batch(values, 0, 1, 10s) == 1 && values[0] == 12);
+
+        bool rejected = false;
+        try {
+            queue.dequeue_batch(values, 4, 2, 1ms);
+        }
+        catch (const std::invalid_argument&) {
+            rejected = true;
+        }
+        CHECK(name, rejected);
+
+        queue.enqueue(10);
+        queue.enqueue(11);
+        queue.close();
+        CHECK(name, queue.dequeue_batch(values, 4, 8, 1s) == 2 && values[0] == 10 && values[1] == 11);
+        CHECK(name, queue.dequeue_batch(values, 1, 8, 1s) == 0);
+        printf("%-24s ok\n", name);
+    }
+
+    const char* name = "rbq batch threads";
+    const uintptr_t count = 50000;
+    rbq<mpmc, rbq_sync::eventcount> queue(16);
+    std::atomic<uintptr_t> dequeued = 0;
+    std::atomic<uintptr_t> dequeued_sum = 0;
+    std::vector<std::thread> threads;
+    for (int ndx = 0; ndx < 2; ndx++)
+        threads.emplace_back([&]() {
+            uintptr_t values[8];
+            uint32_t n;
+            while ((n = queue.dequeue_batch(values, 1, 8, 1ms)) > 0)
+                for (uint32_t k = 0; k < n; k++)
+                {
+                    dequeued_sum += values[k];
+                    dequeued++;
+                }
+        });
+    std::vector<std::thread> producers;
+    for (int ndx = 0; ndx < 4; ndx++)
+        producers.emplace_back([&]() {
+            for (uintptr_t value = 1; value <= count; value++)
+                queue.enqueue(value);
+        });
+    for (auto& thread : producers)
+        thread.join();
+    queue.close();
+    for (auto& thread : threads)
+        thread.join();
+    CHECK(name, dequeued == 4 * count && dequeued_sum == 4 * (count * (count + 1) / 2));
+    printf("%-24s ok\n", name);
+}
+
+/**
+ * @brief futex_semaphore permits, bulk acquire, timeout, and wakeup of a waiting acquire
+ */
+static void test_semaphore()
+{
+    const char* name = "futex_semaphore";
+    using namespace std::chrono_literals;
+    futex_semaphore sem(2);
+
+    CHECK(name, sem.try_acquire());
+    CHECK(name, sem.try_acquire());
+    CHECK(name, !sem.try_acquire());
+    sem.release(5);
+    CHECK(name, sem.try_acquire_many(3) == 3);
+    CHECK(name, sem.try_acquire_many(8) == 2);
+    CHECK(name, sem.try_acquire_many(8) == 0);
+
+    auto start = std::chrono::steady_clock::now();
+    CHECK(name, !sem.try_acquire_until(start + 10ms));
+    CHECK(name, std::chrono::steady_clock::now() - start >= 10ms);
+
+    std::thread releaser([&]() {
+        std::this_thread::sleep_for(5ms);
+        sem.release();
+    });
+    sem.acquire();          // woken by the release
+    releaser.join();
+    CHECK(name, !sem.try_acquire());
+    printf("%-24s ok\n", name);
+}
+
+/**
+ * @brief event_count::post(n) wakes at most n of the waiters, the rest stay counted
+ * and are woken by a later post
+ */
+static void test_post_n()
+{
+    const char* name = "eventcount post(n)";
+    using namespace std::chrono_literals;
+    event_count eventcount;
+    std::atomic<int> woken = 0;
+
+    std::vector<std::thread> threads;
+    for (int ndx = 0; ndx < 3; ndx++)
+        threads.emplace_back([&]() {
+            eventcount.wait(eventcount.mark());
+            woken++;
+        });
+    std::this_thread::sleep_for(20ms);
+
+    eventcount.post(1);
+    while (woken < 1)
+        std::this_thread::yield();
+    std::this_thread::sleep_for(20ms);
+    CHECK(name, woken == 1);
+
+    eventcount.post(2);
+    for (auto& thread : threads)
+        thread.join();
+    CHECK(name, woken == 3);
+    printf("%-24s ok\n", name);
+}
+
+/**
+ * @brief count and sum w/ blocking enqueue and dequeue, for each sync type, adaptive
+ * waits each resolve in one of its phases
+ */
+static void test_rbq_threads()
+{
+    static const char* names[] = {"rbq eventcount threads", "rbq mutex threads", "rbq yield threads", "rbq semaphore threads",
+        "rbq atomic32 threads", "rbq adaptive threads", "rbq handoff threads", "rbq readiness threads", "rbq async threads"};
+
+    for (int sync = rbq_sync::eventcount; sync <= rbq_sync::async; sync++)
+    {
+        rbq<> queue(16, mpmc, (rbq_sync) sync);
+        check_blocking(names[sync], queue, 4, 4, 50000);
+        if (lfrbq_stats_enabled && sync == rbq_sync::adaptive)
+        {
+            lfrbq_stats_t stats = queue.stats();
+            uint64_t waits = stats.producer_waits + stats.consumer_waits;
+            CHECK(names[sync], stats.spin_resolved + stats.yield_resolved + stats.park_resolved == waits);
+        }
+    }
+}
+
+/**
+ * @brief timed enqueue and dequeue time out on full and empty queues, succeed
+ * when another thread makes room or enqueues before the deadline, and return
+ * closed once the queue is closed
+ */
+static void test_rbq_timed()
+{
+    static const char* names[] = {"rbq timed eventcount", "rbq timed mutex", "rbq timed yield", "rbq timed semaphore",
+        "rbq timed atomic32", "rbq timed adaptive", "rbq timed handoff", "rbq timed readiness", "rbq timed async"};
+    using namespace std::chrono_literals;
+
+    for (int sync = rbq_sync::eventcount; sync <= rbq_sync::async; sync++)
+    {
+        const char* name = names[sync];
+        rbq<> queue(4, mpmc, (rbq_sync) sync);
+        uintptr_t value;
+
+        auto start = rbq_clock::now();
+        CHECK(name, queue.dequeue_for(&value, 10ms) == lfrbq_status::timedout);
+        CHECK(name, rbq_clock::now() - start >= 10ms);
+
+        for (uintptr_t ndx = 1; ndx <= 4; ndx++)
+            CHECK(name, queue.enqueue_for(ndx, 10ms) == lfrbq_status::success);
+        start = rbq_clock::now();
+        CHECK(name, queue.enqueue_for(5, 10ms) == lfrbq_status::timedout);
+        CHECK(name, rbq_clock::now() - start >= 10ms);
+        CHECK(name, queue.enqueue_until(5, rbq_clock::now() - 1s) == lfrbq_status::timedout);
+        CHECK(name, queue.dequeue_until(&value, rbq_clock::now() - 1s) == lfrbq_status::success && value == 1);
+
+        std::thread consumer([&]() {
+            std::this_thread::sleep_for(5ms);
+            uintptr_t x;
+            queue.dequeue(&x);
+        });
+        CHECK(name, queue.enqueue_for(5, 10s) == lfrbq_status::success);       // woken by the dequeue
+        consumer.join();
+        for (uintptr_t ndx = 3; ndx <= 5; ndx++)
+            CHECK(name, queue.dequeue_for(&value, 10ms) == lfrbq_status::success && value == ndx);
+
+        std::thread producer([&]() {
+            std::this_thread::sleep_for(5ms);
+            queue.enqueue(6);
+        });
+        CHECK(name, queue.dequeue_for(&value, 10s) == lfrbq_status::success && value == 6);     // woken by the enqueue
+        producer.join();
+
+        std::thread closer([&]() {
+            std::this_thread::sleep_for(5ms);
+            queue.close();
+        });
+        CHECK(name, queue.dequeue_for(&value, 10s) == lfrbq_status::closed);   // woken by the close
+        closer.join();
+        CHECK(name, queue.enqueue_for(7, 10ms) == lfrbq_status::closed);
+        printf("%-24s ok\n", name);
+    }
+}
+
+/**
+ * @brief string values in slot storage, and int values carried in place
+ */
+template<lfrbq_type qtype>
+static void test_tlfrbq(const char* name)
+{
+    tlfrbq<std::string, qtype> queue(4);
+    std::string value;
+
+    for (int ndx = 1; ndx <= 4; ndx++)
+        CHECK(name, queue.try_enqueue(std::to_string(ndx)) == lfrbq_status::success);
+    std::string extra("extra");
+    CHECK(name, queue.try_enqueue(std::move(extra)) == lfrbq_status::full && extra == "extra");
+    for (int ndx = 1; ndx <= 4; ndx++)
+        CHECK(name, queue.try_dequeue(&value) == lfrbq_status::success && value == std::to_string(ndx));
+    CHECK(name, queue.try_dequeue(&value) == lfrbq_status::empty);
+
+    CHECK(name, queue.try_emplace(3, 'x') == lfrbq_status::success);
+    queue.close();
+    CHECK(name, queue.try_enqueue(std::string("y")) == lfrbq_status::closed);
+    CHECK(name, queue.try_dequeue(&value) == lfrbq_status::success && value == "xxx");
+    CHECK(name, queue.try_dequeue(&value) == lfrbq_status::closed);
+
+    tlfrbq<int, qtype> inplace(4);
+    int x;
+    for (int ndx = 1; ndx <= 4; ndx++)
+        CHECK(name, inplace.try_enqueue(ndx) == lfrbq_status::success);
+    CHECK(name, inplace.try_enqueue(5) == lfrbq_status::full);
+    for (int ndx = 1; ndx <= 4; ndx++)
+        CHECK(name, inplace.try_dequeue(&x) == lfrbq_status::success && x == ndx);
+    CHECK(name, inplace.try_dequeue(&x) == lfrbq_status::empty);
+
+    printf("%-24s ok\n", name);
+}
+
+/**
+ * @brief unbounded queues of 8 node segments, so the checks cross segments,
+ * and threaded count and sum checks w/ segments appended and freed concurrently
+ */
+static void test_ulfrbq()
+{
+    {
+        ulfrbq<mpmc> queue(8);
+        check_fifo("ulfrbq unbounded", queue, 0);
+    }
+    {
+        ulfrbq<spsc, lfrbq_compact_node> queue(8);
+        check_fifo("ulfrbq compact spsc", queue, 0);
+    }
+    {
+        ulfrbq<mpmc> queue(8);
+        check_mpmc("ulfrbq mpmc threads", queue, 4, 4, 50000);
+    }
+    {
+        ulfrbq<mpmc_faa> queue(8);
+        check_mpmc("ulfrbq mpmc_faa threads", queue, 4, 4, 50000);
+    }
+    {
+        ulfrbq<mpsc> queue(8);
+        check_mpmc("ulfrbq mpsc threads", queue, 4, 1, 50000);
+    }
+    {
+        ulfrbq<spsc> queue(8);
+        check_mpmc("ulfrbq spsc threads", queue, 1, 1, 50000);
+    }
+    {
+        ulfrbq<mpmc> queue(8, 2, linear_layout, true);
+        check_fifo("ulfrbq bounded", queue, 8);
+    }
+
+    const char* name = "ulfrbq resize";
+    ulfrbq<spsc> queue(8, 2, linear_layout, true);
+    uintptr_t value;
+    for (uintptr_t ndx = 1; ndx <= 8; ndx++)
+        CHECK(name, queue.try_enqueue(ndx) == lfrbq_status::success);
+    CHECK(name, queue.try_enqueue(0) == lfrbq_status::full);
+    CHECK(name, queue.resize(16) && queue.get_capacity() == 16);
+    CHECK(name, !queue.resize(16));
+    for (uintptr_t ndx = 9; ndx <= 24; ndx++)
+        CHECK(name, queue.try_enqueue(ndx) == lfrbq_status::success);
+    CHECK(name, queue.try_enqueue(0) == lfrbq_status::full);
+    CHECK(name, queue.size() == 24);
+    CHECK(name, queue.resize(32));
+    for (uintptr_t ndx = 25; ndx <= 28; ndx++)
+        CHECK(name, queue.try_enqueue(ndx) == lfrbq_status::success);
+    CHECK(name, queue.size() == 28);                    // three linked segments
+    for (uintptr_t ndx = 1; ndx <= 28; ndx++)
+        CHECK(name, queue.try_dequeue(&value) == lfrbq_status::success && value == ndx);
+    CHECK(name, queue.try_dequeue(&value) == lfrbq_status::empty);
+    CHECK(name, queue.size() == 0);
+    queue.close();
+    CHECK(name, queue.try_enqueue(1) == lfrbq_status::closed);
+    CHECK(name, queue.try_dequeue(&value) == lfrbq_status::closed);
+    CHECK(name, !queue.resize(64));
+    printf("%-24s ok\n", name);
+}
+
+/**
+ * @brief poll_resize() grows a full bounded queue and shrinks it again once drained
+ */
+static void test_poll_resize()
+{
+    const char* name = "ulfrbq poll_resize";
+    ulfrbq<mpmc> queue(8, 2, linear_layout, true);
+    ulfrbq_resize_policy policy;
+    policy.high_water = 0.75;
+    policy.low_water = 0.25;
+    policy.dwell = std::chrono::nanoseconds(0);
+    policy.min_capacity = 8;
+    policy.max_capacity = 16;
+    queue.set_resize_policy(policy);
+    uintptr_t value;
+
+    CHECK(name, queue.poll_resize() == 0);
+    for (uintptr_t ndx = 1; ndx <= 8; ndx++)
+        CHECK(name, queue.try_enqueue(ndx) == lfrbq_status::success);
+    CHECK(name, queue.poll_resize() == 0);             // past the high water mark, starts the dwell time
+    CHECK(name, queue.poll_resize() == 16);
+    CHECK(name, queue.poll_resize() == 0);
+    for (uintptr_t ndx = 9; ndx <= 24; ndx++)
+        CHECK(name, queue.try_enqueue(ndx) == lfrbq_status::success);
+    CHECK(name, queue.poll_resize() == 0);
+    CHECK(name, queue.poll_resize() == 0);             // at max_capacity
+    for (uintptr_t ndx = 1; ndx <= 24; ndx++)
+        CHECK(name, queue.try_dequeue(&value) == lfrbq_status::success && value == ndx);
+    CHECK(name, queue.poll_resize() == 0);
+    CHECK(name, queue.poll_resize() == 8);
+    CHECK(name, queue.get_capacity() == 8);
+    printf("%-24s ok\n", name);
+}
+
+/**
+ * @brief count and sum check on a bounded queue w/ another thread resizing it
+ * back and forth the whole time
+ */
+template<lfrbq_type qtype>
+static void test_resize_threads(const char* name, int producers, int consumers)
+{
+    ulfrbq<qtype> queue(16, 2, linear_layout, true);
+    std::atomic<bool> done = false;
+    std::atomic<unsigned int> resizes = 0;
+
+    std::thread resizer([&]() {
+        uint32_t capacity = 16;
+        while (!done.load(std::memory_order_relaxed))
+        {
+            capacity = capacity == 16 ? 32 : 16;
+            if (queue.resize(capacity))
+                resizes.fetch_add(1, std::memory_order_relaxed);
+            std::this_thread::yield();
+        }
+    });
+    check_mpmc(name, queue, producers, consumers, 50000);
+    done.store(true);
+    resizer.join();
+    CHECK(name, resizes.load() > 0);
+}
+
+/**
+ * @brief two forked processes attach to the queue and each enqueue 1 .. count,
+ * this process dequeues them, checks the count, sum, and per producer order,
+ * then closes the queue.  Also checks attaching w/ the wrong queue type fails.
+ */
+template<rbq_sync stype>
+static void test_shmq(const char* name)
+{
+    using queue_t = shmq<mpmc, stype>;
+    const uintptr_t count = 10000;
+    const int producers = 2;
+
+    int fd = memfd_create("queue_test", MFD_CLOEXEC);
+    CHECK(name, fd >= 0);
+    queue_t* queue = queue_t::create(fd, 16);
+
+    pid_t pids[producers];
+    for (int ndx = 0; ndx < producers; ndx++)
+    {
+        pids[ndx] = fork();
+        if (pids[ndx] == 0)
+        {
+            queue_t* child_queue = queue_t::attach(fd);
+            for (uintptr_t value = 1; value <= count; value++)
+                if (child_queue->enqueue(((uintptr_t) ndx << 32) | value) != lfrbq_status::success)
+                    _exit(1);
+            queue_t::detach(child_queue);
+            _exit(0);
+        }
+        CHECK(name, pids[ndx] > 0);
+    }
+
+    uintptr_t value;
+    uintptr_t expected[producers] = {1, 1};
+    bool ordered = true;
+    for (uintptr_t ndx = 0; ndx < producers * count; ndx++)
+    {
+        if (queue->dequeue(&value) != lfrbq_status::success)
+            break;
+        unsigned int producer = value >> 32;
+        ordered &= producer < producers && (value & 0xffffffff) == expected[producer];
+        if (producer < producers)
+            expected[producer]++;
+    }
+    CHECK(name, ordered && expected[0] == count + 1 && expected[1] == count + 1);
+
+    for (int ndx = 0; ndx < producers; ndx++)
+    {
+        int status;
+        CHECK(name, waitpid(pids[ndx], &status, 0) == pids[ndx] && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+
+    CHECK(name, queue->try_enqueue(1) == lfrbq_status::success);
+    queue->close();
+    CHECK(name, queue->try_enqueue(2) == lfrbq_status::closed);
+    CHECK(name, queue->dequeue(&value) == lfrbq_status::success && value == 1);
+    CHECK(name, queue->dequeue(&value) == lfrbq_status::closed);
+
+    bool mismatch = false;
+    try {
+        shmq<spsc, stype>::attach(fd);
+    }
+    catch (const std::invalid_argument&) {
+        mismatch = true;
+    }
+    CHECK(name, mismatch);
+
+    queue_t::detach(queue);
+    close(fd);
+    printf("%-24s ok\n", name);
+}
+
+/**
+ * @brief a waitset returns the indexes of non-empty and closed queues, times out
+ * when none are, and is woken by an enqueue or close from another thread.  Also
+ * checks a queue can't be added twice and a shmq can't post the waitset eventcount,
+ * and that a handoff enqueue wakes a blocked dequeue w/ the waitset waiting too.
+ */
+template<rbq_sync stype>
+static void test_waitset(const char* name, bool use_waitv)
+{
+    using namespace std::chrono_literals;
+    rbq<mpmc, stype> queues[3]{rbq<mpmc, stype>(16), rbq<mpmc, stype>(16), rbq<mpmc, stype>(16)};
+    rbq_waitset<rbq<mpmc, stype>> waitset(use_waitv);
+    std::vector<size_t> ready;
+    uintptr_t value;
+
+    for (size_t ndx = 0; ndx < 3; ndx++)
+        CHECK(name, waitset.add(queues[ndx]) == ndx);
+    CHECK(name, waitset.size() == 3);
+
+    auto start = rbq_clock::now();
+    CHECK(name, waitset.wait_for(ready, 10ms) == 0 && ready.empty());
+    CHECK(name, rbq_clock::now() - start >= 10ms);
+
+    queues[1].enqueue(1);
+    CHECK(name, waitset.wait(ready) == 1 && ready[0] == 1);
+    queues[2].enqueue(2);
+    CHECK(name, waitset.wait_for(ready, 10ms) == 2 && ready[0] == 1 && ready[1] == 2);
+    queues[1].dequeue(&value);
+    queues[2].dequeue(&value);
+
+    std::thread producer([&]() {
+        std::this_thread::sleep_for(5ms);
+        queues[2].enqueue(3);
+    });
+    CHECK(name, waitset.wait(ready) == 1 && ready[0] == 2);      // woken by the enqueue
+    producer.join();
+    queues[2].dequeue(&value);
+
+    std::thread closer([&]() {
+        std::this_thread::sleep_for(5ms);
+        queues[0].close();
+    });
+    CHECK(name, waitset.wait_for(ready, 10s) == 1 && ready[0] == 0);     // woken by the close
+    closer.join();
+
+    if constexpr (stype == rbq_sync::handoff)
+    {
+        // a single value wakes the blocked dequeue, not just the waitset thread
+        rbq<mpmc, stype> queue(16);
+        rbq_waitset<rbq<mpmc, stype>> queue_waitset(use_waitv);
+        queue_waitset.add(queue);
+        lfrbq_status status = lfrbq_status::empty;
+        std::thread waiter([&]() {
+            std::vector<size_t> waiter_ready;
+            queue_waitset.wait_for(waiter_ready, 10s);
+        });
+        std::this_thread::sleep_for(5ms);
+        std::thread consumer([&]() { status = queue.dequeue_for(&value, 10s); });
+        std::this_thread::sleep_for(5ms);
+        start = rbq_clock::now();
+        queue.enqueue(4);
+        consumer.join();
+        CHECK(name, status == lfrbq_status::success && value == 4);
+        CHECK(name, rbq_clock::now() - start < 5s);
+        waiter.join();
+    }
+
+    if (!use_waitv)
+    {
+        rbq_waitset<rbq<mpmc, stype>> other(use_waitv);
+        bool rejected = false;
+        try {
+            other.add(queues[1]);
+        }
+        catch (const std::invalid_argument&) {
+            rejected = true;
+        }
+        CHECK(name, rejected);
+
+        using shmq_t = shmq<mpmc, stype>;
+        int fd = memfd_create("queue_test", MFD_CLOEXEC);
+        shmq_t* queue = shmq_t::create(fd, 16);
+        rbq_waitset<shmq_t> shared(use_waitv);
+        rejected = false;
+        try {
+            shared.add(*queue);
+        }
+        catch (const std::invalid_argument&) {
+            rejected = true;
+        }
+        CHECK(name, rejected);
+        shmq_t::detach(queue);
+        close(fd);
+    }
+    printf("%-24s ok\n", name);
+}
+
+/**
+ * @brief fd is readable, w/o waiting
+ */
+static bool fd_readable(int fd)
+{
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    return poll(&pfd, 1, 0) == 1;
+}
+
+/**
+ * @brief readiness fds are written only on the transitions they were armed
+ * for and on close, and a consumer polling dequeue_fd() and draining w/
+ * dequeue_bulk_ready() gets every value
+ */
+static void test_readiness()
+{
+    const char* name = "rbq readiness fds";
+    rbq<mpmc, rbq_sync::readiness> queue(4);
+    uintptr_t value;
+    uintptr_t values[8];
+
+    CHECK(name, !fd_readable(queue.dequeue_fd()) && !fd_readable(queue.enqueue_fd()));
+    CHECK(name, queue.dequeue_ready(&value) == lfrbq_status::empty);
+    CHECK(name, !fd_readable(queue.dequeue_fd()));
+    CHECK(name, queue.enqueue_ready(1) == lfrbq_status::success);
+    CHECK(name, fd_readable(queue.dequeue_fd()));
+    CHECK(name, queue.enqueue_ready(2) == lfrbq_status::success);
+    CHECK(name, queue.dequeue_bulk_ready(values, 8) == 2 && values[0] == 1 && values[1] == 2);
+    CHECK(name, queue.dequeue_bulk_ready(values, 8) == 0);
+    CHECK(name, !fd_readable(queue.dequeue_fd()));      // reset by arming
+
+    for (uintptr_t ndx = 1; ndx <= 4; ndx++)
+        CHECK(name, queue.enqueue_ready(ndx) == lfrbq_status::success);
+    CHECK(name, queue.enqueue_ready(5) == lfrbq_status::full);
+    CHECK(name, !fd_readable(queue.enqueue_fd()));
+    CHECK(name, queue.dequeue_ready(&value) == lfrbq_status::success && value == 1);
+    CHECK(name, fd_readable(queue.enqueue_fd()));
+    CHECK(name, queue.enqueue_ready(5) == lfrbq_status::success);
+
+    queue.close();
+    CHECK(name, fd_readable(queue.dequeue_fd()) && fd_readable(queue.enqueue_fd()));
+    CHECK(name, queue.dequeue_bulk_ready(values, 8) == 4 && values[0] == 2 && values[3] == 5);
+    CHECK(name, queue.dequeue_ready(&value) == lfrbq_status::closed);
+    CHECK(name, queue.dequeue_bulk_ready(values, 8) == 0 && fd_readable(queue.dequeue_fd()));     // still readable after arming
+    printf("%-24s ok\n", name);
+
+    name = "rbq readiness poll";
+    const uintptr_t count = 50000;
+    rbq<mpmc, rbq_sync::readiness> pqueue(16);
+    std::thread producer([&]() {
+        for (uintptr_t ndx = 1; ndx <= count; ndx++)
+            pqueue.enqueue(ndx);
+        pqueue.close();
+    });
+
+    uintptr_t n = 0;
+    uintptr_t sum = 0;
+    for (;;)
+    {
+        bool closed = pqueue.closed();
+        uint32_t got;
+        while ((got = pqueue.dequeue_bulk_ready(values, 8)) > 0)
+            for (uint32_t ndx = 0; ndx < got; ndx++, n++)
+                sum += values[ndx];
+        if (closed)
+            break;
+        struct pollfd pfd = { pqueue.dequeue_fd(), POLLIN, 0 };
+        poll(&pfd, 1, -1);
+    }
+    producer.join();
+    CHECK(name, n == count && sum == count * (count + 1) / 2);
+    printf("%-24s ok\n", name);
+}
+
+/**
+ * @brief fire and forget coroutine, runs until its first suspension when called
+ */
+struct detached_task
+{
+    struct promise_type
+    {
+        detached_task get_return_object() { return {}; }
+        std::suspend_never initial_suspend() { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+using async_queue = rbq<mpmc, rbq_sync::async>;
+
+/**
+ * @brief enqueue 1 .. count, counting successful enqueues, and the status that ended it
+ */
+static detached_task async_producer(async_queue& queue, uintptr_t count, std::atomic<uintptr_t>& enqueued, lfrbq_status& last)
+{
+    lfrbq_status status = lfrbq_status::success;
+    for (uintptr_t value = 1; value <= count; value++)
+    {
+        if ((status = co_await queue.async_enqueue(value)) != lfrbq_status::success)
+            break;
+        enqueued++;
+    }
+    last = status;
+}
+
+/**
+ * @brief dequeue until closed, counting and summing the values
+ */
+static detached_task async_consumer(async_queue& queue, std::atomic<uintptr_t>& dequeued, std::atomic<uintptr_t>& sum, lfrbq_status& last)
+{
+    uintptr_t value;
+    lfrbq_status status;
+    while ((status = co_await queue.async_dequeue(&value)) == lfrbq_status::success)
+    {
+        sum += value;
+        dequeued++;
+    }
+    last = status;
+}
+
+/**
+ * @brief executor that queues the handles for the test to resume
+ */
+static void defer_resume(void* arg, std::coroutine_handle<> handle)
+{
+    ((std::vector<std::coroutine_handle<>>*) arg)->push_back(handle);
+}
+
+/**
+ * @brief coroutines suspend on full and empty, have their enqueues and dequeues
+ * done by the other side, are resumed inline or through the executor, are
+ * resumed w/ closed on close, and count and sum w/ coroutines on one side and
+ * threads on the other
+ */
+static void test_async()
+{
+    const char* name = "rbq async";
+    uintptr_t value;
+    std::atomic<uintptr_t> enqueued = 0;
+    std::atomic<uintptr_t> dequeued = 0;
+    std::atomic<uintptr_t> sum = 0;
+    lfrbq_status plast = lfrbq_status::empty;
+    lfrbq_status clast = lfrbq_status::empty;
+
+    {
+        async_queue queue(2);
+        async_producer(queue, 4, enqueued, plast);
+        CHECK(name, enqueued == 2);                     // suspended on full
+        CHECK(name, queue.dequeue(&value) == lfrbq_status::success && value == 1);
+        CHECK(name, enqueued == 3);                     // 3 enqueued by the dequeue, resumed inline
+        CHECK(name, queue.dequeue(&value) == lfrbq_status::success && value == 2);
+        CHECK(name, enqueued == 4 && plast == lfrbq_status::success);
+        CHECK(name, queue.dequeue(&value) == lfrbq_status::success && value == 3);
+        CHECK(name, queue.dequeue(&value) == lfrbq_status::success && value == 4);
+
+        async_consumer(queue, dequeued, sum, clast);
+        CHECK(name, dequeued == 0);                     // suspended on empty
+        CHECK(name, queue.enqueue(5) == lfrbq_status::success);
+        CHECK(name, dequeued == 1 && sum == 5);         // dequeued by the enqueue
+        queue.close();
+        CHECK(name, clast == lfrbq_status::closed);     // resumed by the close
+    }
+
+    {
+        std::vector<std::coroutine_handle<>> handles;
+        async_queue queue(2);
+        queue.set_executor(defer_resume, &handles);
+        enqueued = 0;
+        async_producer(queue, 3, enqueued, plast);
+        CHECK(name, enqueued == 2);
+        CHECK(name, queue.dequeue(&value) == lfrbq_status::success && value == 1);
+        CHECK(name, handles.size() == 1 && enqueued == 2);      // enqueue done, resume deferred
+        CHECK(name, queue.size() == 2);
+        handles[0].resume();
+        CHECK(name, enqueued == 3 && plast == lfrbq_status::success);
+        handles.clear();
+
+        async_producer(queue, 1, enqueued, plast);     // suspended on full
+        queue.close();
+        CHECK(name, handles.size() == 1);
+        handles[0].resume();
+        CHECK(name, plast == lfrbq_status::closed);
+    }
+    printf("%-24s ok\n", name);
+
+    name = "rbq async coroutines";
+    const uintptr_t count = 50000;
+    {
+        async_queue queue(16);
+        dequeued = 0;
+        sum = 0;
+        lfrbq_status last[4];
+        for (int ndx = 0; ndx < 4; ndx++)
+            async_consumer(queue, dequeued, sum, last[ndx]);
+        std::vector<std::thread> threads;
+        for (int ndx = 0; ndx < 4; ndx++)
+            threads.emplace_back([&]() {
+                for (uintptr_t value = 1; value <= count; value++)
+                    queue.enqueue(value);
+            });
+        for (auto& thread : threads)
+            thread.join();
+        queue.close();
+        CHECK(name, dequeued == 4 * count && sum == 4 * (count * (count + 1) / 2));
+        for (int ndx = 0; ndx < 4; ndx++)
+            CHECK(name, last[ndx] == lfrbq_status::closed);
+    }
+    {
+        async_queue queue(16);
+        std::atomic<uintptr_t> produced[4] = {0, 0, 0, 0};
+        lfrbq_status last[4];
+        std::atomic<uintptr_t> n = 0;
+        sum = 0;
+        std::vector<std::thread> threads;
+        for (int ndx = 0; ndx < 4; ndx++)
+            threads.emplace_back([&]() {
+                uintptr_t value;
+                while (queue.dequeue(&value) == lfrbq_status::success)
+                {
+                    sum += value;
+                    n++;
+                }
+            });
+        for (int ndx = 0; ndx < 4; ndx++)
+            async_producer(queue, count, produced[ndx], last[ndx]);
+        bool done = false;
+        while (!done)
+        {
+            std::this_thread::yield();
+            done = true;
+            for (int ndx = 0; ndx < 4; ndx++)
+                done &= produced[ndx] == count;
+        }
+        queue.close();
+        for (auto& thread : threads)
+            thread.join();
+        CHECK(name, n == 4 * count && sum == 4 * (count * (count + 1) / 2));
+    }
+    printf("%-24s ok\n", name);
+}
+
+/**
+ * @brief string payloads through try_enqueue/try_dequeue and in place through
+ * reserve/commit and acquire/release, and threaded count and sum checks
+ */
+static void test_zlfrbq()
+{
+    const char* name = "zlfrbq";
+    zlfrbq<std::string, mpmc> queue(4);
+    std::string value;
+
+    for (int ndx = 1; ndx <= 4; ndx++)
+        CHECK(name, queue.try_enqueue(std::to_string(ndx)) == lfrbq_status::success);
+    CHECK(name, queue.try_enqueue("5") == lfrbq_status::full);
+    for (int ndx = 1; ndx <= 4; ndx++)
+        CHECK(name, queue.try_dequeue(&value) == lfrbq_status::success && value == std::to_string(ndx));
+    CHECK(name, queue.try_dequeue(&value) == lfrbq_status::empty);
+
+    std::string* payload;
+    CHECK(name, queue.try_reserve(&payload) == lfrbq_status::success);
+    *payload = "in place";
+    CHECK(name, queue.try_acquire(&payload) == lfrbq_status::empty);    // not committed yet
+    queue.commit(payload);
+    CHECK(name, queue.try_acquire(&payload) == lfrbq_status::success && *payload == "in place");
+    queue.release(payload);
+
+    CHECK(name, queue.try_enqueue("last") == lfrbq_status::success);
+    queue.close();
+    CHECK(name, queue.try_enqueue("after") == lfrbq_status::closed);
+    CHECK(name, queue.try_dequeue(&value) == lfrbq_status::success && value == "last");
+    CHECK(name, queue.try_dequeue(&value) == lfrbq_status::closed);
+    printf("%-24s ok\n", name);
+
+    {
+        zlfrbq<uintptr_t, mpmc> queue(16);
+        check_fifo("zlfrbq mpmc", queue, 16);
+    }
+    {
+        zlfrbq<uintptr_t, mpmc> queue(64);
+        check_mpmc("zlfrbq mpmc threads", queue, 4, 4, 50000);
+    }
+    {
+        zlfrbq<uintptr_t, mpmc, lfrbq_compact_node> queue(64);
+        check_mpmc("zlfrbq compact threads", queue, 4, 4, 50000);
+    }
+    {
+        zlfrbq<uintptr_t, spsc> queue(64);
+        check_mpmc("zlfrbq spsc threads", queue, 1, 1, 50000);
+    }
+}
+
+/**
+ * @brief values come out highest priority first, FIFO w/in a priority, and
+ * threaded count and sum checks w/ values spread over the priorities
+ */
+static void test_prbq()
+{
+    const char* name = "prbq";
+    prbq<mpmc> queue(3, 4);
+    uintptr_t value;
+    unsigned int prio;
+
+    for (uintptr_t ndx = 1; ndx <= 4; ndx++)
+        CHECK(name, queue.try_enqueue(ndx, 2) == lfrbq_status::success);
+    CHECK(name, queue.try_enqueue(5, 2) == lfrbq_status::full);
+    CHECK(name, queue.try_enqueue(10, 0) == lfrbq_status::success);
+    CHECK(name, queue.try_enqueue(11, 0) == lfrbq_status::success);
+    CHECK(name, queue.try_enqueue(20, 7) == lfrbq_status::full);        // past the last level is the last
+
+    CHECK(name, queue.try_dequeue(&value, &prio) == lfrbq_status::success && value == 10 && prio == 0);
+    CHECK(name, queue.try_dequeue(&value, &prio) == lfrbq_status::success && value == 11 && prio == 0);
+    for (uintptr_t ndx = 1; ndx <= 4; ndx++)
+        CHECK(name, queue.try_dequeue(&value, &prio) == lfrbq_status::success && value == ndx && prio == 2);
+    CHECK(name, queue.try_dequeue(&value) == lfrbq_status::empty);
+    CHECK(name, queue.try_enqueue(20, 7) == lfrbq_status::success);
+    CHECK(name, queue.try_dequeue(&value, &prio) == lfrbq_status::success && value == 20 && prio == 2);
+
+    CHECK(name, queue.enqueue(7, 1) == lfrbq_status::success);
+    queue.close();
+    CHECK(name, queue.enqueue(8, 1) == lfrbq_status::closed);
+    CHECK(name, queue.dequeue(&value) == lfrbq_status::success && value == 7);
+    CHECK(name, queue.dequeue(&value) == lfrbq_status::closed);
+    printf("%-24s ok\n", name);
+
+    {
+        prbq<mpmc> queue(4, 16);
+        check_blocking("prbq threads", queue, 4, 4, 50000,
+            [](prbq<mpmc>& queue, uintptr_t value) { return queue.enqueue(value, value % 4); },
+            [](prbq<mpmc>& queue, uintptr_t* value) { return queue.dequeue(value); });
+    }
+    {
+        prbq<> queue(64, 4, mpsc);
+        check_blocking("prbq runtime mpsc threads", queue, 4, 1, 50000,
+            [](prbq<>& queue, uintptr_t value) { return queue.enqueue(value, value % 64); },
+            [](prbq<>& queue, uintptr_t* value) { return queue.dequeue(value); });
+    }
+}
+
+/**
+ * @brief a single thread fills its own shard and spills to the others, and
+ * threaded count and sum checks w/ the try, bulk, and blocking API
+ */
+template<lfrbq_type qtype>
+static void test_srbq(const char* name)
+{
+    srbq<qtype> queue(4, 4);
+    uintptr_t value;
+    uintptr_t sum = 0;
+
+    for (uintptr_t ndx = 1; ndx <= 4; ndx++)
+        CHECK(name, queue.try_enqueue(ndx) == lfrbq_status::success);
+    for (uintptr_t ndx = 1; ndx <= 4; ndx++)                        // local shard, in order
+        CHECK(name, queue.try_dequeue(&value) == lfrbq_status::success && value == ndx);
+    CHECK(name, queue.try_dequeue(&value) == lfrbq_status::empty);
+
+    for (uintptr_t ndx = 1; ndx <= 16; ndx++)                       // spills to the other shards
+        CHECK(name, queue.try_enqueue(ndx) == lfrbq_status::success);
+    CHECK(name, queue.try_enqueue(17) == lfrbq_status::full);
+    for (uintptr_t ndx = 1; ndx <= 16; ndx++)
+    {
+        CHECK(name, queue.try_dequeue(&value) == lfrbq_status::success);
+        sum += value;
+    }
+    CHECK(name, sum == 16 * 17 / 2);
+    CHECK(name, queue.try_dequeue(&value) == lfrbq_status::empty);
+
+    CHECK(name, queue.try_enqueue(1) == lfrbq_status::success);
+    queue.close();
+    CHECK(name, queue.try_enqueue(2) == lfrbq_status::closed);
+    CHECK(name, queue.dequeue(&value) == lfrbq_status::success && value == 1);
+    CHECK(name, queue.dequeue(&value) == lfrbq_status::closed);
+    printf("%-24s ok\n", name);
+
+    char thread_name[64];
+    {
+        srbq<qtype> queue(4, 16);
+        snprintf(thread_name, sizeof(thread_name), "%s threads", name);
+        check_mpmc(thread_name, queue, 4, 4, 50000);
+    }
+    {
+        srbq<qtype> queue(4, 16);
+        snprintf(thread_name, sizeof(thread_name), "%s bulk threads", name);
+        check_mpmc(thread_name, queue, 4, 4, 50000, 8);
+    }
+    {
+        srbq<qtype> queue(4, 16);
+        snprintf(thread_name, sizeof(thread_name), "%s blocking", name);
+        check_blocking(thread_name, queue, 4, 4, 50000);
+    }
+    {
+        srbq<qtype> queue(2, 16, linear_layout, {}, shard_by_cpu);
+        snprintf(thread_name, sizeof(thread_name), "%s by cpu", name);
+        check_blocking(thread_name, queue, 4, 4, 50000);
+    }
+}
+
+/**
+ * @brief full and empty counts are per queue and summed over threads, for more
+ * queues than the thread local cache has entries, and for queues made of queues
+ */
+static void test_stats()
+{
+    const char* name = "stats";
+    if constexpr (!lfrbq_stats_enabled)
+    {
+        printf("%-24s skipped, LFRBQ_STATS=0\n", name);
+        return;
+    }
+
+    const unsigned int nqueues = 40;
+    std::vector<lfrbq<mpmc>*> queues;
+    for (unsigned int ndx = 0; ndx < nqueues; ndx++)
+        queues.push_back(new lfrbq<mpmc>(2));
+
+    std::vector<std::thread> threads;
+    for (int thread = 0; thread < 4; thread++)
+        threads.emplace_back([&]() {
+            uintptr_t value;
+            for (int pass = 0; pass < 100; pass++)
+                for (unsigned int ndx = 0; ndx < nqueues; ndx++)
+                    for (unsigned int k = 0; k <= ndx; k++)
+                        queues[ndx]->try_dequeue(&value);
+        });
+    for (auto& thread : threads)
+        thread.join();
+
+    bool counted = true;
+    for (unsigned int ndx = 0; ndx < nqueues; ndx++)
+    {
+        lfrbq_stats_t stats = queues[ndx]->stats();
+        counted &= stats.queue_empty_count == 4 * 100 * (ndx + 1) && stats.queue_full_count == 0;
+        delete queues[ndx];
+    }
+    CHECK(name, counted);
+
+    lfrbq<mpmc> queue(2);
+    queue.try_enqueue(1);
+    queue.try_enqueue(2);
+    queue.try_enqueue(3);
+    CHECK(name, queue.stats().queue_full_count == 1);
+    uintptr_t values[2] = {4, 5};
+    CHECK(name, queue.try_enqueue_bulk(values, 2) == 0);
+    CHECK(name, queue.stats().queue_full_count == 2);
+
+    prbq<mpmc> pqueue(3, 2);
+    pqueue.try_enqueue(1, 1);
+    pqueue.try_enqueue(2, 1);
+    pqueue.try_enqueue(3, 1);
+    pqueue.try_enqueue(4, 2);
+    pqueue.try_enqueue(5, 2);
+    pqueue.try_enqueue(6, 2);
+    CHECK(name, pqueue.stats().queue_full_count == 2);
+
+    srbq<mpmc> squeue(1, 2);
+    squeue.try_enqueue(1);
+    squeue.try_enqueue(2);
+    squeue.try_enqueue(3);
+    CHECK(name, squeue.stats().queue_full_count == 1);
+
+    ulfrbq<mpmc> uqueue(2, 2, linear_layout, true);
+    uqueue.try_enqueue(1);
+    uqueue.try_enqueue(2);
+    uqueue.try_enqueue(3);
+    CHECK(name, uqueue.stats().queue_full_count == 1);
+
+    printf("%-24s ok\n", name);
+}
+
+/**
+ * @brief size() follows enqueues and dequeues, across the wrap, for each queue type
+ */
+template<typename Q>
+static void check_size(const char* name, Q& queue, uint32_t capacity)
+{
+    uintptr_t value;
+    bool ok = queue.size() == 0;
+    for (int pass = 0; pass < 3; pass++)
+    {
+        for (uint32_t ndx = 1; ndx <= capacity; ndx++)
+        {
+            queue.try_enqueue(ndx);
+            ok &= queue.size() == ndx;
+        }
+        for (uint32_t ndx = 1; ndx <= capacity; ndx++)
+        {
+            queue.try_dequeue(&value);
+            ok &= queue.size() == capacity - ndx;
+        }
+    }
+    CHECK(name, ok);
+    printf("%-24s ok\n", name);
+}
+
+struct watermark_calls
+{
+    int high = 0;
+    int low = 0;
+    uint32_t size = 0;
+};
+
+static void watermark_callback(void* arg, bool high, uint32_t size)
+{
+    watermark_calls* calls = (watermark_calls*) arg;
+    (high ? calls->high : calls->low)++;
+    calls->size = size;
+}
+
+template<typename Q>
+constexpr bool has_watermarks = requires (Q& queue) { queue.set_watermarks(8, 2); };
+
+/**
+ * @brief watermark callbacks on crossing high and then low, once each, and
+ * watermark argument checks
+ */
+static void test_watermarks()
+{
+    const char* name = "rbq watermarks";
+    rbq<mpmc, rbq_sync::eventcount> queue(16);
+    watermark_calls calls;
+    uintptr_t value;
+
+    queue.set_watermarks(8, 2, watermark_callback, &calls);
+    for (uintptr_t ndx = 1; ndx <= 7; ndx++)
+        queue.enqueue(ndx);
+    CHECK(name, calls.high == 0 && !queue.above_watermark());
+    queue.enqueue(8);
+    CHECK(name, calls.high == 1 && calls.size == 8 && queue.above_watermark());
+    queue.enqueue(9);
+    CHECK(name, calls.high == 1);
+    for (uintptr_t ndx = 1; ndx <= 6; ndx++)
+        queue.dequeue(&value);
+    CHECK(name, calls.low == 0 && queue.above_watermark());
+    queue.dequeue(&value);
+    CHECK(name, calls.low == 1 && calls.size == 2 && !queue.above_watermark());
+    queue.dequeue(&value);
+    CHECK(name, calls.low == 1 && calls.high == 1);
+
+    bool thrown = false;
+    try {
+        queue.set_watermarks(17, 2);
+    }
+    catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    CHECK(name, thrown);
+
+    static_assert(has_watermarks<rbq<mpmc, rbq_sync::eventcount>> && !has_watermarks<shmq<mpmc>>);
+    printf("%-24s ok\n", name);
+}
+
+int main(int argc, char** argv)
+{
+    test_lfrbq<mpmc>("lfrbq mpmc", "lfrbq bulk mpmc");
+    test_lfrbq<mpsc>("lfrbq mpsc", "lfrbq bulk mpsc");
+    test_lfrbq<spmc>("lfrbq spmc", "lfrbq bulk spmc");
+    test_lfrbq<spsc>("lfrbq spsc", "lfrbq bulk spsc");
+    test_lfrbq<mpmc_faa>("lfrbq mpmc_faa", "lfrbq bulk mpmc_faa");
+    {
+        lfrbq<spmc> queue(16);
+        check_cached("lfrbq spmc cached head", queue);
+    }
+    {
+        lfrbq<spsc> queue(16);
+        check_cached("lfrbq spsc cached", queue);
+    }
+    {
+        lfrbq<> queue(16, mpsc);
+        check_bulk("lfrbq bulk runtime mpsc", queue);
+    }
+    test_spread<mpmc>("lfrbq spread mpmc");
+    test_spread<spsc>("lfrbq spread spsc");
+    {
+        lfrbq<spsc> queue(16, spread_layout);
+        check_cached("lfrbq spread cached", queue);
+    }
+    {
+        lfrbq<mpmc> queue(64);
+        check_mpmc("lfrbq mpmc threads", queue, 4, 4, 50000);
+    }
+    {
+        lfrbq<mpmc> queue(64);
+        check_mpmc("lfrbq bulk mpmc threads", queue, 4, 4, 50000, 8);
+    }
+    {
+        lfrbq<mpmc> queue(64, spread_layout);
+        check_mpmc("lfrbq spread threads", queue, 4, 4, 50000);
+    }
+    {
+        lfrbq<mpmc_faa> queue(64);
+        check_mpmc("lfrbq mpmc_faa threads", queue, 4, 4, 50000);
+    }
+    {
+        lfrbq<mpmc_faa> queue(64);
+        check_mpmc("lfrbq bulk mpmc_faa threads", queue, 4, 4, 50000, 8);
+    }
+    {
+        lfrbq<mpmc_faa> queue(4);
+        check_mpmc("lfrbq mpmc_faa 4 threads", queue, 4, 4, 50000);
+    }
+    {
+        lfrbq<mpmc_faa> queue(4);
+        check_mpmc("lfrbq bulk mpmc_faa 4 threads", queue, 4, 4, 50000, 8);
+    }
+    {
+        lfrbq<mpmc_faa> queue(4);
+        check_mpmc("lfrbq mpmc_faa skip threads", queue, 1, 6, 50000);
+    }
+    {
+        lfrbq<mpmc_faa, lfrbq_compact_node> queue(64);
+        check_mpmc("lfrbq compact mpmc_faa threads", queue, 4, 4, 50000);
+    }
+    {
+        lfrbq<mpmc, lfrbq_compact_node> queue(64);
+        check_mpmc("lfrbq compact threads", queue, 4, 4, 50000);
+    }
+    {
+        lfrbq<mpmc, lfrbq_compact_node> queue(64);
+        check_mpmc("lfrbq compact bulk threads", queue, 4, 4, 50000, 8);
+    }
+    {
+        lfrbq<spsc> queue(64);
+        check_mpmc("lfrbq spsc threads", queue, 1, 1, 50000);
+    }
+    {
+        lfrbq<spsc> queue(64);
+        check_mpmc("lfrbq bulk spsc threads", queue, 1, 1, 50000, 8);
+    }
+    test_compact();
+    test_alloc();
+    test_rbq_bulk();
+    test_rbq_timed();
+    test_rbq_batch();
+    test_semaphore();
+    test_post_n();
+    test_rbq_threads();
+    test_tlfrbq<mpmc>("tlfrbq mpmc");
+    test_tlfrbq<mpsc>("tlfrbq mpsc");
+    test_tlfrbq<spsc>("tlfrbq spsc");
+    test_tlfrbq<mpmc_faa>("tlfrbq mpmc_faa");
+    test_ulfrbq();
+    test_poll_resize();
+    test_resize_threads<mpmc>("ulfrbq resize threads", 4, 4);
+    test_resize_threads<mpmc_faa>("ulfrbq resize mpmc_faa", 4, 4);
+    test_shmq<rbq_sync::eventcount>("shmq eventcount");
+    test_shmq<rbq_sync::yield>("shmq yield");
+    test_shmq<rbq_sync::adaptive>("shmq adaptive");
+    test_shmq<rbq_sync::handoff>("shmq handoff");
+    test_waitset<rbq_sync::eventcount>("waitset eventcount", true);
+    test_waitset<rbq_sync::eventcount>("waitset posting", false);
+    test_waitset<rbq_sync::yield>("waitset yield", true);
+    test_waitset<rbq_sync::handoff>("waitset handoff", true);
+    test_readiness();
+    test_async();
+    test_zlfrbq();
+    test_prbq();
+    test_srbq<mpmc>("srbq mpmc");
+    test_srbq<mpmc_faa>("srbq mpmc_faa");
+    test_stats();
+    {
+        lfrbq<mpmc> queue(16);
+        check_size("size lfrbq mpmc", queue, 16);
+    }
+    {
+        lfrbq<spsc> queue(16);
+        check_size("size lfrbq spsc", queue, 16);
+    }
+    {
+        lfrbq<mpmc_faa, lfrbq_compact_node> queue(16);
+        check_size("size lfrbq mpmc_faa", queue, 16);
+    }
+    {
+        tlfrbq<uintptr_t, mpmc> queue(16);
+        check_size("size tlfrbq", queue, 16);
+    }
+    {
+        zlfrbq<uintptr_t, mpmc> queue(16);
+        check_size("size zlfrbq", queue, 16);
+    }
+    {
+        srbq<mpmc> queue(4, 4);
+        check_size("size srbq", queue, 16);
+    }
+    test_watermarks();
+
+    if (failures != 0)
+    {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    printf("all ok\n");
+    return 0;
+}
+
+/*==*/
@@ -50,13 +50,21 @@ static int find_enum(const char** names, char* opt)
     return -1;
 }
 
-static const char* qtype_names[] = {"mpmc", "mpsc", "spmc", "spsc", NULL};
-static const lfrbq_type qtype[] = {mpmc, mpsc, spmc, spsc};
-static const char* qtype_choices = "{mpmc, mpsc, spmc, spsc}";
+static const char* qtype_names[] = {"mpmc", "mpsc", "spmc", "spsc", "mpmc_faa", NULL};
+static const lfrbq_type qtype[] = {mpmc, mpsc, spmc, spsc, mpmc_faa};
+static const char* qtype_choices = "{mpmc, mpsc, spmc, spsc, mpmc_faa}";
 
-static const char* sync_names[] = {"eventcount", "mutex", "yield", "semaphore", "atomic32", NULL};
-static const rbq_sync sync_values[] = {rbq_sync::eventcount, rbq_sync::mutex, rbq_sync::yield , rbq_sync::semaphore,  rbq_sync::atomic32};
-static const char* sync_choices = "{eventcount, mutex, yield, semaphore, atomic32}";
+static const char* sync_names[] = {"eventcount", "mutex", "yield", "semaphore", "atomic32", "adaptive", "handoff", "readiness", "async", NULL};
+static const rbq_sync sync_values[] = {rbq_sync::eventcount, rbq_sync::mutex, rbq_sync::yield , rbq_sync::semaphore,  rbq_sync::atomic32, rbq_sync::adaptive, rbq_sync::handoff, rbq_sync::readiness, rbq_sync::async};
+static const char* sync_choices = "{eventcount, mutex, yield, semaphore, atomic32, adaptive, handoff, readiness, async}";
+
+static const char* layout_names[] = {"linear", "spread", NULL};
+static const lfrbq_layout layout_values[] = {linear_layout, spread_layout};
+static const char* layout_choices = "{linear, spread}";
+
+static const char* pages_names[] = {"default", "thp", "2m", "1g", NULL};
+static const lfrbq_pages pages_values[] = {default_pages, thp_pages, huge_2m, huge_1g};
+static const char* pages_choices = "{default, thp, 2m, 1g}";
 
 
 
@@ -72,9 +80,28 @@ typedef struct testconfig_t {
 
     unsigned int count;         // enqueue count -- per producer
 
+    unsigned int batch;         // enqueue/dequeue batch size, 1 = single value api
+
     rbq_sync sync;
     const char* sync_name;
 
+    bool static_types;          // use queue w/ compile time queue and sync types
+
+    lfrbq_layout layout;        // ring buffer node layout
+    const char* layout_name;
+
+    bool compact;               // use compact 64 bit queue nodes
+
+    unsigned int shards;        // srbq shard count, 0 for rbq
+
+    bool latency;               // measure enqueue to dequeue latency, messages are timestamps
+
+    bool all_sync;              // run w/ each sync type and compare
+
+    lfrbq_alloc_options alloc;  // ring buffer page type, NUMA policy, and prefault
+    const char* pages_name;
+    const char* numa_name;
+
     bool quiet;
 
     bool verbose;
@@ -91,8 +118,19 @@ static const testconfig_t testconfig_init = {
     nproducers : 1,
     nconsumers : 1,
     count : 0,
+    batch : 1,
     sync : rbq_sync::eventcount,
     sync_name : "eventcount",
+    static_types : false,
+    layout : linear_layout,
+    layout_name : "linear",
+    compact : false,
+    shards : 0,
+    latency : false,
+    all_sync : false,
+    alloc : {},
+    pages_name : "default",
+    numa_name : "default",
     quiet : false,
     verbose : false,
     debug : false,
@@ -110,6 +148,15 @@ static struct option long_options[] = {
     {"consumers", required_argument, 0, 'c'},
     {"size", required_argument, 0, 's'},
     {"sync", required_argument, 0, 'x'},
+    {"batch", required_argument, 0, 'b'},
+    {"static", no_argument, 0, 'S'},
+    {"layout", required_argument, 0, 'l'},
+    {"compact", no_argument, 0, 'C'},
+    {"shards", required_argument, 0, 'k'},
+    {"latency", no_argument, 0, 'L'},
+    {"pages", required_argument, 0, 'P'},
+    {"numa", required_argument, 0, 'N'},
+    {"prefault", no_argument, 0, 'F'},
     {"quiet", no_argument, 0, 'q'},
     {"verbose", no_argument, 0, 'v'},
     {"debug", no_argument, 0, 'd'},
@@ -194,6 +241,10 @@ static bool parse_options(testconfig_t* config, int argc, char** argv)
                 config->capacity = strtoul(optarg, NULL, 10);
                 break;
             case 'x':
+                if (strcasecmp(optarg, "all") == 0) {
+                    config->all_sync = true;
+                    break;
+                }
                 ndx = find_enum(sync_names, optarg);
                 if (ndx >= 0) {
                     config->sync = sync_values[ndx];
@@ -204,6 +255,61 @@ static bool parse_options(testconfig_t* config, int argc, char** argv)
                     retval = false;
                 }
                 break;
+            case 'b':
+                config->batch = strtoul(optarg, NULL, 10);
+                break;
+            case 'S':
+                config->static_types = true;
+                break;
+            case 'C':
+                config->compact = true;
+                break;
+            case 'k':
+                config->shards = strtoul(optarg, NULL, 10);
+                break;
+            case 'L':
+                config->latency = true;
+                break;
+            case 'l':
+                ndx = find_enum(layout_names, optarg);
+                if (ndx >= 0) {
+                    config->layout = layout_values[ndx];
+                    config->layout_name = optarg;
+                }
+                else {
+                    fprintf(stderr, "unknown layout=%s\n", optarg);
+                    retval = false;
+                }
+                break;
+            case 'P':
+                ndx = find_enum(pages_names, optarg);
+                if (ndx >= 0) {
+                    config->alloc.pages = pages_values[ndx];
+                    config->pages_name = optarg;
+                }
+                else {
+                    fprintf(stderr, "unknown pages=%s\n", optarg);
+                    retval = false;
+                }
+                break;
+            case 'N':
+                if (strcasecmp(optarg, "interleave") == 0) {
+                    config->alloc.numa = numa_interleave;
+                    config->numa_name = optarg;
+                }
+                else if (*optarg >= '0' && *optarg <= '9' && strtoul(optarg, NULL, 10) < 64) {
+                    config->alloc.numa = numa_bind;
+                    config->alloc.numa_nodes = (uint64_t) 1 << strtoul(optarg, NULL, 10);
+                    config->numa_name = optarg;
+                }
+                else {
+                    fprintf(stderr, "unknown numa=%s\n", optarg);
+                    retval = false;
+                }
+                break;
+            case 'F':
+                config->alloc.prefault = true;
+                break;
             case 'q':
                 config->quiet = true;
                 break;
@@ -228,6 +334,14 @@ static bool parse_options(testconfig_t* config, int argc, char** argv)
 
     free(short_options);
 
+    retval &= check(config->batch == 0, "batch must be >= 1");
+
+    if (config->shards > 0)
+    {
+        retval &= check(config->qtype != mpmc && config->qtype != mpmc_faa, "sharded queue type must be mpmc or mpmc_faa");
+        retval &= check(config->sync != rbq_sync::eventcount || config->all_sync, "sharded queue sync must be eventcount");
+    }
+
     if (config->sync != mutex)
     {
         switch (config->qtype)
@@ -255,8 +369,17 @@ static bool parse_options(testconfig_t* config, int argc, char** argv)
         fprintf(stderr, "  -t --type <arg>  queue type %s (default %s)\n", qtype_choices, testconfig_init.qtype_name);
         fprintf(stderr, "  -p --producers <arg>  number of producer threads (default %u)\n", testconfig_init.nproducers);
         fprintf(stderr, "  -c --consumers <arg>  number of producer threads (default %u)\n", testconfig_init.nconsumers);
-        fprintf(stderr, "  -x --sync <name> queue enqueue/dequeue synchronization %s (default %s)\n", sync_choices, testconfig_init.sync_name);
+        fprintf(stderr, "  -x --sync <name> queue enqueue/dequeue synchronization %s, or all to compare them (default %s)\n", sync_choices, testconfig_init.sync_name);
         fprintf(stderr, "  -s --size <arg>  queue capacity (power of 2) (default %u)\n", testconfig_init.capacity);
+        fprintf(stderr, "  -b --batch <arg>  enqueue/dequeue batch size, 1 for single value api (default %u)\n", testconfig_init.batch);
+        fprintf(stderr, "  -S --static use queue w/ compile time type and sync (default false)\n");
+        fprintf(stderr, "  -l --layout <name> ring buffer node layout %s (default %s)\n", layout_choices, testconfig_init.layout_name);
+        fprintf(stderr, "  -C --compact use compact 64 bit queue nodes, 32 bit values (default false)\n");
+        fprintf(stderr, "  -L --latency measure enqueue to dequeue latency percentiles (default false)\n");
+        fprintf(stderr, "  -k --shards <arg>  sharded queue w/ <arg> shards of capacity each, 0 for unsharded (default %u)\n", testconfig_init.shards);
+        fprintf(stderr, "  -P --pages <name> ring buffer pages %s (default %s)\n", pages_choices, testconfig_init.pages_name);
+        fprintf(stderr, "  -N --numa <node>|interleave bind ring buffer to numa node or interleave across nodes (default first touch)\n");
+        fprintf(stderr, "  -F --prefault prefault ring buffer pages at allocation (default false)\n");
         fprintf(stderr, "  -q --quiet less output (default false)\n");
         fprintf(stderr, "  -v --verbose show config values (default false)\n");
         fprintf(stderr, "  -h --help show config values (default false)\n");
@@ -273,6 +396,16 @@ static bool parse_options(testconfig_t* config, int argc, char** argv)
         fprintf(stderr, "  consumers=%u\n", config->nconsumers);
         fprintf(stderr, "  sync=%s\n", config->sync_name);
         fprintf(stderr, "  capacity=%u\n", config->capacity);
+        fprintf(stderr, "  batch=%u\n", config->batch);
+        fprintf(stderr, "  static=%s\n", config->static_types ? "true" : "false");
+        fprintf(stderr, "  layout=%s\n", config->layout_name);
+        fprintf(stderr, "  compact=%s\n", config->compact ? "true" : "false");
+        fprintf(stderr, "  shards=%u\n", config->shards);
+        fprintf(stderr, "  latency=%s\n", config->latency ? "true" : "false");
+        fprintf(stderr, "  all sync=%s\n", config->all_sync ? "true" : "false");
+        fprintf(stderr, "  pages=%s\n", config->pages_name);
+        fprintf(stderr, "  numa=%s\n", config->numa_name);
+        fprintf(stderr, "  prefault=%s\n", config->alloc.prefault ? "true" : "false");
         fprintf(stderr, "  quiet=%s\n", config->quiet ? "true" : "false");
         fprintf(stderr, "  verbose=%s\n", config->verbose ? "true" : "false");
         fprintf(stderr, "  debug=%s\n", config->debug ? "true" : "false");